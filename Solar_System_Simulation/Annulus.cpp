@@ -0,0 +1,77 @@
+#include <glad/glad.h>
+#include <header/Annulus.h>
+
+#include <cmath>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const int MIN_ANNULUS_SECTOR_COUNT = 3;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+Annulus::Annulus(float innerRadius, float outerRadius, int sectors, int textureInt, int textureGL, unsigned int texture)
+    : textureInt(textureInt), textureGL(textureGL), texture(texture), vertexArray(0), vertexBuffer(0), indexBuffer(0)
+{
+    set(innerRadius, outerRadius, sectors);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// setters
+///////////////////////////////////////////////////////////////////////////////
+void Annulus::set(float innerRadius, float outerRadius, int sectors)
+{
+    this->innerRadius = innerRadius > 0.0f ? innerRadius : 0.0f;
+    this->outerRadius = outerRadius > this->innerRadius ? outerRadius : this->innerRadius;
+    this->sectorCount = sectors < MIN_ANNULUS_SECTOR_COUNT ? MIN_ANNULUS_SECTOR_COUNT : sectors;
+    buildVertices();
+}
+
+void Annulus::setBuffers(unsigned int vertexArray, unsigned int vertexBuffer, unsigned int indexBuffer)
+{
+    this->vertexArray = vertexArray;
+    this->vertexBuffer = vertexBuffer;
+    this->indexBuffer = indexBuffer;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// two circles of sectorCount + 1 vertices, the seam is duplicated for t
+// the inner circle is inscribed in the inner edge and the outer circle
+// circumscribes the outer edge, so the polygon covers the whole annulus
+///////////////////////////////////////////////////////////////////////////////
+void Annulus::buildVertices()
+{
+    std::vector<float>().swap(interleavedVertices);
+    std::vector<unsigned int>().swap(indices);
+
+    const float PI = acos(-1.0f);
+    float sectorStep = 2 * PI / sectorCount;
+    float outer = outerRadius / cosf(sectorStep * 0.5f);
+
+    for (int j = 0; j <= sectorCount; ++j)
+    {
+        float sectorAngle = j * sectorStep;
+        float c = cosf(sectorAngle), s = sinf(sectorAngle);
+        float t = (float)j / sectorCount;
+
+        const float edge[2][2] = { { innerRadius, 0.0f }, { outer, 1.0f } };
+        for (int k = 0; k < 2; ++k)
+        {
+            float vertex[8] = { edge[k][0] * c, edge[k][0] * s, 0.0f, 0.0f, 0.0f, 1.0f, edge[k][1], t };
+            interleavedVertices.insert(interleavedVertices.end(), vertex, vertex + 8);
+        }
+    }
+
+    for (unsigned int j = 0; j < (unsigned int)sectorCount; ++j)
+    {
+        unsigned int k = 2 * j;     // inner vertex of this sector, outer is k + 1
+        const unsigned int quad[6] = { k, k + 1, k + 2, k + 2, k + 1, k + 3 };
+        indices.insert(indices.end(), quad, quad + 6);
+    }
+}
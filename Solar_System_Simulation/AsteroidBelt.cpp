@@ -0,0 +1,297 @@
+#include <header/AsteroidBelt.h>
+#include <header/camera.h>
+#include <header/Profiler.h>
+#include <header/RenderBackend.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const double GAUSS_K = 0.01720209895;      // mean motion of a 1 AU orbit, rad/day
+const float BELT_COLOR[3] = { 0.55f, 0.5f, 0.45f };
+
+const char* const BELT_FEEDBACK_VARYINGS[] = { "Position" };
+
+// unit octahedron, 8 triangles per rock
+const float ROCK_VERTICES[] = {
+     1.0f,  0.0f,  0.0f,   -1.0f,  0.0f,  0.0f,
+     0.0f,  1.0f,  0.0f,    0.0f, -1.0f,  0.0f,
+     0.0f,  0.0f,  1.0f,    0.0f,  0.0f, -1.0f
+};
+const unsigned int ROCK_INDICES[] = {
+    0, 2, 4,   2, 1, 4,   1, 3, 4,   3, 0, 4,
+    2, 0, 5,   1, 2, 5,   3, 1, 5,   0, 3, 5
+};
+
+// per particle orbit as read by belt_update.vs
+struct AsteroidElements
+{
+    float axisA[4];
+    float axisB[4];
+    float motion[2];
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+AsteroidBeltConfig::AsteroidBeltConfig() : count(ASTEROID_COUNT), innerAU(2.1f), outerAU(3.3f),
+    maxEccentricity(0.2f), maxInclination(15.0f), minSize(0.004f), maxSize(0.015f), seed(1801)
+{
+}
+
+AsteroidBelt::AsteroidBelt() : updateShader(NULL), drawShader(NULL), count(0), indexCount(0),
+    elementBuffer(0), positionBuffer(0), meshBuffer(0), meshIndexBuffer(0), updateVAO(0), drawVAO(0)
+{
+}
+
+AsteroidBelt::~AsteroidBelt()
+{
+    destroy();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// generate random orbits and upload them with the rock mesh
+///////////////////////////////////////////////////////////////////////////////
+bool AsteroidBelt::create(const AsteroidBeltConfig& config)
+{
+    destroy();
+    if (config.count == 0)
+        return false;
+
+    std::mt19937 random(config.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double TWO_PI = 6.283185307179586;
+
+    std::vector<AsteroidElements> elements(config.count);
+    for (unsigned int i = 0; i < config.count; ++i)
+    {
+        double a = config.innerAU + (config.outerAU - config.innerAU) * unit(random);
+        double e = config.maxEccentricity * unit(random);
+        double inc = glm::radians((double)config.maxInclination) * unit(random);
+        double node = TWO_PI * unit(random);
+        double peri = TWO_PI * unit(random);
+
+        // periapsis and in-plane normal directions in the ecliptic frame
+        double cn = std::cos(node), sn = std::sin(node);
+        double cp = std::cos(peri), sp = std::sin(peri);
+        double ci = std::cos(inc), si = std::sin(inc);
+        glm::dvec3 p(cn * cp - sn * sp * ci, sn * cp + cn * sp * ci, sp * si);
+        glm::dvec3 q(-cn * sp - sn * cp * ci, -sn * sp + cn * cp * ci, cp * si);
+        p *= a;
+        q *= a * std::sqrt(1.0 - e * e);
+
+        // ecliptic (x, y, z) to scene (x, z, -y), as for the planets
+        AsteroidElements& el = elements[i];
+        el.axisA[0] = (float)p.x;  el.axisA[1] = (float)p.z;  el.axisA[2] = (float)-p.y;  el.axisA[3] = (float)e;
+        el.axisB[0] = (float)q.x;  el.axisB[1] = (float)q.z;  el.axisB[2] = (float)-q.y;  el.axisB[3] = (float)(TWO_PI * unit(random));
+        el.motion[0] = (float)(GAUSS_K / (a * std::sqrt(a)));
+        el.motion[1] = config.minSize + (config.maxSize - config.minSize) * (float)unit(random);
+    }
+
+    updateShader = new Shader("belt_update.vs", BELT_FEEDBACK_VARYINGS, 1);
+    drawShader = new Shader("belt.vs", "belt.fs");
+    drawShader->use();
+    drawShader->setVec2("logDepth", LogDepthParameters());
+    count = config.count;
+    indexCount = sizeof(ROCK_INDICES) / sizeof(ROCK_INDICES[0]);
+
+    // propagation pass: orbits in, positions out
+    glGenVertexArrays(1, &updateVAO);
+    glGenBuffers(1, &elementBuffer);
+    glState.bindVertexArray(updateVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, elementBuffer);
+    glState.bufferData(elementBuffer, GL_ARRAY_BUFFER, elements.size() * sizeof(AsteroidElements), &elements[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(AsteroidElements), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(AsteroidElements), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(AsteroidElements), (void*)(8 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glGenBuffers(1, &positionBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glState.bufferData(positionBuffer, GL_ARRAY_BUFFER, count * 4 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+
+    // draw pass: rock mesh per vertex, position per instance
+    glGenVertexArrays(1, &drawVAO);
+    glGenBuffers(1, &meshBuffer);
+    glGenBuffers(1, &meshIndexBuffer);
+    glState.bindVertexArray(drawVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+    glState.bufferData(meshBuffer, GL_ARRAY_BUFFER, sizeof(ROCK_VERTICES), ROCK_VERTICES, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshIndexBuffer);
+    glState.bufferData(meshIndexBuffer, GL_ELEMENT_ARRAY_BUFFER, sizeof(ROCK_INDICES), ROCK_INDICES, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    glState.bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void AsteroidBelt::destroy()
+{
+    if (count == 0)
+        return;
+
+    glState.deleteVertexArray(updateVAO);
+    glState.deleteVertexArray(drawVAO);
+    glState.deleteBuffer(elementBuffer);
+    glState.deleteBuffer(positionBuffer);
+    glState.deleteBuffer(meshBuffer);
+    glState.deleteBuffer(meshIndexBuffer);
+    glState.deleteProgram(updateShader->ID);
+    glState.deleteProgram(drawShader->ID);
+    delete updateShader;
+    delete drawShader;
+
+    updateShader = drawShader = NULL;
+    count = indexCount = 0;
+    elementBuffer = positionBuffer = meshBuffer = meshIndexBuffer = updateVAO = drawVAO = 0;
+}
+
+unsigned int AsteroidBelt::getMemoryBytes() const
+{
+    return count * (unsigned int)(sizeof(AsteroidElements) + 4 * sizeof(float));
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// one point per particle through the propagation shader, nothing is rasterized
+///////////////////////////////////////////////////////////////////////////////
+void AsteroidBelt::update(double day, float auScale)
+{
+    if (count == 0)
+        return;
+    ProfileScope scope(PROFILE_SIMULATION);
+
+    // the shader works in float, keep the day within a few centuries of J2000
+    updateShader->use();
+    updateShader->setFloat("day", (float)day);
+    updateShader->setFloat("auScale", auScale);
+
+    glState.enable(GL_RASTERIZER_DISCARD);
+    glState.bindVertexArray(updateVAO);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, positionBuffer);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, count);
+    glState.countDraw(GL_POINTS, count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glState.disable(GL_RASTERIZER_DISCARD);
+}
+
+void AsteroidBelt::draw(const glm::mat4& projection, const glm::mat4& view, const glm::dvec3& eye)
+{
+    if (count == 0)
+        return;
+    ProfileScope scope(PROFILE_BELT);
+
+    drawShader->use();
+    drawShader->setMat4("projection", projection);
+    drawShader->setMat4("view", view);
+    drawShader->setVec3("origin", glm::vec3(-eye));
+    drawShader->setVec3("color", BELT_COLOR[0], BELT_COLOR[1], BELT_COLOR[2]);
+
+    glState.bindVertexArray(drawVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, count);
+    glState.countDraw(GL_TRIANGLES, indexCount, count);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CPU submission and GPU time of a belt frame for several particle counts,
+// rendered offscreen by RenderBackend: surfaceless EGL, a hidden window without it
+///////////////////////////////////////////////////////////////////////////////
+int benchmarkAsteroidBelt(int argc, char** argv)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int WARMUP_FRAMES = 10;
+    const int FRAMES = 100;
+    const int WIDTH = 800, HEIGHT = 600;
+
+    std::vector<unsigned int> counts;
+    for (int i = 2; i < argc; ++i)
+        counts.push_back((unsigned int)std::strtoul(argv[i], NULL, 10));
+    if (counts.empty())
+    {
+        counts.push_back(100000);
+        counts.push_back(250000);
+        counts.push_back(500000);
+        counts.push_back(1000000);
+    }
+
+    // the offscreen context of the render loops, EGL without a display when built with it
+    BackendOptions options;
+    options.type = BACKEND_OFFSCREEN;
+    options.overlay = false;
+    RenderBackend backend;
+    if (!backend.create(options, WIDTH, HEIGHT, "Solar_System benchmark"))
+        return -1;
+    glState.enable(GL_DEPTH_TEST);
+
+    // looking at the belt from above Mars' orbit
+    float auScale = 4.0f;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, NEAR_PLANE, FAR_PLANE);
+    glm::dvec3 eye(0.0, 10.0, 14.0);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(-eye), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    unsigned int query;
+    glGenQueries(1, &query);
+
+    std::cout << "particles      cpu us/frame   gpu ms/frame   gpu memory MB" << std::endl;
+    for (std::size_t c = 0; c < counts.size(); ++c)
+    {
+        AsteroidBeltConfig config;
+        config.count = counts[c];
+        AsteroidBelt belt;
+        if (!belt.create(config))
+            continue;
+
+        double cpuSeconds = 0.0;
+        GLuint64 gpuNanoseconds = 0;
+        for (int f = 0; f < WARMUP_FRAMES + FRAMES; ++f)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            Clock::time_point start = Clock::now();
+            belt.update(f * 0.5, auScale);
+            belt.draw(projection, view, eye);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            glEndQuery(GL_TIME_ELAPSED);
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if (f >= WARMUP_FRAMES)
+            {
+                cpuSeconds += seconds;
+                gpuNanoseconds += elapsed;
+            }
+        }
+
+        std::printf("%9u %17.2f %14.3f %15.1f\n", counts[c], cpuSeconds / FRAMES * 1e6,
+            gpuNanoseconds / (double)FRAMES * 1e-6, belt.getMemoryBytes() / (1024.0 * 1024.0));
+        belt.destroy();
+    }
+
+    glDeleteQueries(1, &query);
+    backend.destroy();
+    return 0;
+}
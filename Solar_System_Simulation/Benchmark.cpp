@@ -0,0 +1,301 @@
+#include <header/Benchmark.h>
+#include <header/solar.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int BENCHMARK_DEFAULT_WARMUP = 5;        // frames left out of the statistics, the first compiles and uploads
+const char* const BENCHMARK_DEFAULT_OUTPUT = "benchmark.json";
+const char* const BENCHMARK_MODE_NAMES[] = { "size", "distance" };
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// camera paths
+///////////////////////////////////////////////////////////////////////////////
+CameraPath::CameraPath() : mode(BENCHMARK_SIZE)
+{
+}
+
+double CameraPath::duration() const
+{
+    return keys.empty() ? 0.0 : keys.back().time;
+}
+
+static glm::dvec3 catmullRom(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2, const glm::dvec3& p3, double u)
+{
+    double u2 = u * u, u3 = u2 * u;
+    return 0.5 * (2.0 * p1 + (p2 - p0) * u + (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * u2 + (3.0 * p1 - p0 - 3.0 * p2 + p3) * u3);
+}
+
+void CameraPath::apply(double time, Camera& camera) const
+{
+    if (keys.empty())
+        return;
+
+    // key span holding the time, the ends are held
+    std::size_t next = 0;
+    while (next < keys.size() && keys[next].time <= time)
+        ++next;
+    if (next == 0 || next == keys.size())
+    {
+        const CameraKey& key = next == 0 ? keys.front() : keys.back();
+        camera = Camera(key.position, glm::vec3(0.0f, 1.0f, 0.0f), key.yaw, key.pitch);
+        camera.Zoom = key.zoom;
+        return;
+    }
+
+    const CameraKey& a = keys[next - 1];
+    const CameraKey& b = keys[next];
+    const CameraKey& before = next >= 2 ? keys[next - 2] : a;
+    const CameraKey& after = next + 1 < keys.size() ? keys[next + 1] : b;
+    double u = (time - a.time) / (b.time - a.time);
+    float f = (float)u;
+
+    glm::dvec3 position = catmullRom(before.position, a.position, b.position, after.position, u);
+    camera = Camera(position, glm::vec3(0.0f, 1.0f, 0.0f), a.yaw + (b.yaw - a.yaw) * f, a.pitch + (b.pitch - a.pitch) * f);
+    camera.Zoom = a.zoom + (b.zoom - a.zoom) * f;
+}
+
+bool loadCameraPaths(const char* path, std::vector<CameraPath>& paths)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::BENCHMARK::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        // a line naming a path starts it, the key lines after it belong to it
+        std::istringstream tokens(line);
+        std::string token;
+        CameraKey key;
+        key.time = 0.0;
+        key.position = glm::dvec3(0.0);
+        key.yaw = YAW;
+        key.pitch = PITCH;
+        key.zoom = ZOOM;
+        bool isKey = false;
+        while (tokens >> token)
+        {
+            std::size_t eq = token.find('=');
+            std::string name = token.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : token.substr(eq + 1);
+
+            if (name == "name")
+            {
+                paths.push_back(CameraPath());
+                paths.back().name = value;
+            }
+            else if (name == "mode" && !paths.empty() && (value == "size" || value == "distance"))
+                paths.back().mode = value == "size" ? BENCHMARK_SIZE : BENCHMARK_DISTANCE;
+            else if (name == "t")
+            {
+                key.time = std::atof(value.c_str());
+                isKey = true;
+            }
+            else if (name == "pos")
+                std::sscanf(value.c_str(), "%lf,%lf,%lf", &key.position.x, &key.position.y, &key.position.z);
+            else if (name == "yaw")
+                key.yaw = (float)std::atof(value.c_str());
+            else if (name == "pitch")
+                key.pitch = (float)std::atof(value.c_str());
+            else if (name == "zoom")
+                key.zoom = (float)std::atof(value.c_str());
+            else
+            {
+                std::cout << "ERROR::BENCHMARK::UNKNOWN_KEY: " << path << ":" << lineNumber << " " << token << std::endl;
+                return false;
+            }
+        }
+
+        if (isKey)
+        {
+            if (paths.empty() || (!paths.back().keys.empty() && key.time <= paths.back().keys.back().time))
+            {
+                std::cout << "ERROR::BENCHMARK::INVALID_KEY: " << path << ":" << lineNumber << std::endl;
+                return false;
+            }
+            paths.back().keys.push_back(key);
+        }
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// statistics
+///////////////////////////////////////////////////////////////////////////////
+// one measure over the frames after the warmup, written as {"mean": .., "p50": .., "p99": .., "max": ..}
+static void writeSummary(std::ofstream& output, const char* name, std::vector<float> values)
+{
+    float mean = 0.0f, p50 = 0.0f, p99 = 0.0f, max = 0.0f;
+    if (!values.empty())
+    {
+        std::sort(values.begin(), values.end());
+        double total = 0.0;
+        for (std::size_t i = 0; i < values.size(); ++i)
+            total += values[i];
+        mean = (float)(total / values.size());
+
+        // nearest rank
+        p50 = values[(values.size() * 50 + 99) / 100 - 1];
+        p99 = values[(values.size() * 99 + 99) / 100 - 1];
+        max = values.back();
+    }
+    output << "      \"" << name << "\": { \"mean\": " << mean << ", \"p50\": " << p50
+        << ", \"p99\": " << p99 << ", \"max\": " << max << " }";
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] == '"' || text[i] == '\\')
+            quoted += '\\';
+        if ((unsigned char)text[i] >= 0x20)
+            quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// command line
+///////////////////////////////////////////////////////////////////////////////
+int runBenchmark(int argc, char** argv)
+{
+    const char* pathFile = FLYTHROUGH_FILE;
+    const char* outputPath = BENCHMARK_DEFAULT_OUTPUT;
+    unsigned int frames = 0;
+    unsigned int warmup = BENCHMARK_DEFAULT_WARMUP;
+    int onlyMode = -1;
+    bool backgroundBlack = false;
+    BackendOptions options;
+    options.type = BACKEND_OFFSCREEN;
+    options.overlay = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--paths") == 0 && i + 1 < argc)
+            pathFile = argv[++i];
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--frame-time") == 0 && i + 1 < argc)
+            options.frameTime = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmup = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+        {
+            ++i;
+            onlyMode = std::strcmp(argv[i], "size") == 0 ? BENCHMARK_SIZE : std::strcmp(argv[i], "distance") == 0 ? BENCHMARK_DISTANCE : -2;
+        }
+        else if (std::strcmp(argv[i], "--black") == 0)
+            backgroundBlack = true;
+        else
+        {
+            pathFile = NULL;
+            break;
+        }
+    }
+
+    std::vector<CameraPath> paths;
+    if (!pathFile || onlyMode == -2 || options.frameTime <= 0.0 || !loadCameraPaths(pathFile, paths))
+    {
+        std::cout << "usage: --benchmark [--paths file] [--output file.json] [--frames N] [--frame-time seconds]"
+            " [--warmup N] [--mode size|distance] [--black]" << std::endl;
+        return -1;
+    }
+
+    std::ofstream output(outputPath);
+    if (!output)
+    {
+        std::cout << "ERROR::BENCHMARK::FILE_NOT_SUCCESSFULLY_WRITTEN: " << outputPath << std::endl;
+        return -1;
+    }
+
+    FrameLog log;
+    options.log = &log;
+    bool first = true;
+    int failed = 0;
+    output << "{\n  \"width\": " << viewportWidth << ",\n  \"height\": " << viewportHeight << ",\n  \"frame_time\": " << options.frameTime
+        << ",\n  \"warmup\": " << warmup << ",\n  \"runs\": [";
+    for (std::size_t p = 0; p < paths.size(); ++p)
+    {
+        const CameraPath& path = paths[p];
+        if (onlyMode >= 0 && path.mode != onlyMode)
+            continue;
+
+        // every run starts from the same clock, by default the whole path is flown
+        options.cameraPath = &path;
+        options.frames = frames ? frames : (unsigned int)(path.duration() / options.frameTime) + 1;
+        simulationClock = SimulationClock();
+        deltaTime = lastFrame = 0.0f;
+
+        std::cout << "Benchmark " << path.name << " (" << BENCHMARK_MODE_NAMES[path.mode] << "), " << options.frames << " frames" << std::endl;
+        int result = path.mode == BENCHMARK_SIZE ? solarScaledSize(backgroundBlack, options) : solarScaledDistance(backgroundBlack, options);
+        if (result != 0 || log.frames.empty())
+        {
+            std::cout << "ERROR::BENCHMARK::RUN_FAILED: " << path.name << std::endl;
+            ++failed;
+            continue;
+        }
+
+        std::vector<float> cpu, frame, gpu, draws, triangles, changes;
+        for (std::size_t f = std::min<std::size_t>(warmup, log.frames.size() - 1); f < log.frames.size(); ++f)
+        {
+            const FrameStats& stats = log.frames[f];
+            cpu.push_back(stats.cpuMs);
+            frame.push_back(stats.frameMs);
+            gpu.push_back(stats.gpuMs);
+            draws.push_back((float)stats.drawCalls);
+            triangles.push_back((float)stats.triangles);
+            changes.push_back((float)stats.stateChanges);
+        }
+
+        output << (first ? "\n" : ",\n") << "    {\n      \"path\": " << jsonString(path.name)
+            << ",\n      \"mode\": \"" << BENCHMARK_MODE_NAMES[path.mode] << "\",\n      \"renderer\": " << jsonString(log.renderer)
+            << ",\n      \"frames\": " << log.frames.size() << ",\n      \"measured\": " << cpu.size() << ",\n";
+        writeSummary(output, "cpu_ms", cpu);
+        output << ",\n";
+        writeSummary(output, "frame_ms", frame);
+        output << ",\n";
+        writeSummary(output, "gpu_ms", gpu);
+        output << ",\n";
+        writeSummary(output, "draw_calls", draws);
+        output << ",\n";
+        writeSummary(output, "triangles", triangles);
+        output << ",\n";
+        writeSummary(output, "state_changes", changes);
+        output << "\n    }";
+        first = false;
+    }
+    output << "\n  ]\n}\n";
+
+    if (!output.flush())
+    {
+        std::cout << "ERROR::BENCHMARK::FILE_NOT_SUCCESSFULLY_WRITTEN: " << outputPath << std::endl;
+        return -1;
+    }
+    std::cout << "Benchmark results written to " << outputPath << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+#include <header/BodyTransform.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const float TWO_OVER_PI = 0.636619772f;
+const float PI_OVER_TWO_1 = 1.5703125f;                   // pi / 2 split in three parts,
+const float PI_OVER_TWO_2 = 4.837512969970703125e-4f;      // the first two with few enough bits
+const float PI_OVER_TWO_3 = 7.54978995489188216e-8f;       // that q * part is exact
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sine and cosine of an array with branch-free quadrant selection so the loop vectorizes
+// x is reduced to [-pi/4, pi/4] (Cody-Waite), then evaluated with Taylor polynomials
+///////////////////////////////////////////////////////////////////////////////
+static void sinCosArray(const float* __restrict x, float* __restrict s, float* __restrict c, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float xi = x[i];
+        int quadrant = (int)(xi * TWO_OVER_PI + (xi >= 0.0f ? 0.5f : -0.5f));
+        float q = (float)quadrant;
+        float r = ((xi - q * PI_OVER_TWO_1) - q * PI_OVER_TWO_2) - q * PI_OVER_TWO_3;
+        float r2 = r * r;
+
+        float sr = r + r * r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f + r2 * (1.0f / 362880.0f))));
+        float cr = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f))));
+
+        // quadrant 0: (sr, cr), 1: (cr, -sr), 2: (-sr, -cr), 3: (-cr, sr)
+        int odd = quadrant & 1;
+        float sBase = odd ? cr : sr;
+        float cBase = odd ? sr : cr;
+        s[i] = (quadrant & 2) ? -sBase : sBase;
+        c[i] = ((quadrant + 1) & 2) ? -cBase : cBase;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// tilt of a body: axial tilt around (1, 0, 1), then a quarter turn around X
+///////////////////////////////////////////////////////////////////////////////
+glm::quat bodyTilt(float rotationAxis)
+{
+    glm::quat tilt = glm::angleAxis(glm::radians(360.0f - rotationAxis), glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)));
+    return tilt * glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+}
+
+glm::mat4 bodyModelReference(float orbitAngle, float distance, float rotationAxis, float spinAngle)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, orbitAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::translate(model, glm::vec3(distance, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(360.0f - rotationAxis), glm::vec3(1.0f, 0.0f, 1.0f));
+    model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, spinAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+    return model;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// storage
+///////////////////////////////////////////////////////////////////////////////
+void BodyTransformBatch::reserve(unsigned int count)
+{
+    orbitAngles.reserve(count);
+    distances.reserve(count);
+    spinAngles.reserve(count);
+    offsetX.reserve(count);
+    offsetY.reserve(count);
+    offsetZ.reserve(count);
+    tilts.reserve(count);
+    for (int k = 0; k < 9; ++k)
+        tiltMatrix[k].reserve(count);
+    sinOrbit.reserve(count);
+    cosOrbit.reserve(count);
+    sinSpin.reserve(count);
+    cosSpin.reserve(count);
+    orbits.reserve(count);
+    models.reserve(count);
+    exactOrbitAngles.reserve(count);
+    exactDistances.reserve(count);
+    exactOffsets.reserve(count);
+    positions.reserve(count);
+}
+
+void BodyTransformBatch::clear()
+{
+    orbitAngles.clear();
+    distances.clear();
+    spinAngles.clear();
+    offsetX.clear();
+    offsetY.clear();
+    offsetZ.clear();
+    tilts.clear();
+    for (int k = 0; k < 9; ++k)
+        tiltMatrix[k].clear();
+    sinOrbit.clear();
+    cosOrbit.clear();
+    sinSpin.clear();
+    cosSpin.clear();
+    orbits.clear();
+    models.clear();
+    exactOrbitAngles.clear();
+    exactDistances.clear();
+    exactOffsets.clear();
+    positions.clear();
+}
+
+int BodyTransformBatch::add(float rotationAxis)
+{
+    int body = (int)orbitAngles.size();
+    orbitAngles.push_back(0.0f);
+    distances.push_back(0.0f);
+    spinAngles.push_back(0.0f);
+    offsetX.push_back(0.0f);
+    offsetY.push_back(0.0f);
+    offsetZ.push_back(0.0f);
+    tilts.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    for (int k = 0; k < 9; ++k)
+        tiltMatrix[k].push_back(0.0f);
+    sinOrbit.push_back(0.0f);
+    cosOrbit.push_back(1.0f);
+    sinSpin.push_back(0.0f);
+    cosSpin.push_back(1.0f);
+    orbits.push_back(glm::mat4(1.0f));
+    models.push_back(glm::mat4(1.0f));
+    exactOrbitAngles.push_back(0.0);
+    exactDistances.push_back(0.0);
+    exactOffsets.push_back(glm::dvec3(0.0));
+    positions.push_back(glm::dvec3(0.0));
+
+    setTilt(body, rotationAxis);
+    return body;
+}
+
+void BodyTransformBatch::setTilt(int body, float rotationAxis)
+{
+    tilts[body] = bodyTilt(rotationAxis);
+    glm::mat3 m = glm::mat3_cast(tilts[body]);
+    for (int col = 0; col < 3; ++col)
+        for (int row = 0; row < 3; ++row)
+            tiltMatrix[col * 3 + row][body] = m[col][row];
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// compose every body in two flat passes: sin/cos of all angles, then the matrices
+// tilt * rotate(spin, Y) has columns (c*T0 - s*T2, T1, s*T0 + c*T2),
+// rotate(orbit, Y) maps (x, y, z) to (c*x + s*z, y, -s*x + c*z)
+///////////////////////////////////////////////////////////////////////////////
+void BodyTransformBatch::compose()
+{
+    const std::size_t count = orbitAngles.size();
+    if (count == 0)
+        return;
+
+    sinCosArray(orbitAngles.data(), sinOrbit.data(), cosOrbit.data(), count);
+    sinCosArray(spinAngles.data(), sinSpin.data(), cosSpin.data(), count);
+
+    const float* so = sinOrbit.data();
+    const float* co = cosOrbit.data();
+    const float* ss = sinSpin.data();
+    const float* cs = cosSpin.data();
+
+    const float* d = distances.data();
+    const float* ox = offsetX.data();
+    const float* oy = offsetY.data();
+    const float* oz = offsetZ.data();
+    const float* t00 = tiltMatrix[0].data(); const float* t01 = tiltMatrix[1].data(); const float* t02 = tiltMatrix[2].data();
+    const float* t10 = tiltMatrix[3].data(); const float* t11 = tiltMatrix[4].data(); const float* t12 = tiltMatrix[5].data();
+    const float* t20 = tiltMatrix[6].data(); const float* t21 = tiltMatrix[7].data(); const float* t22 = tiltMatrix[8].data();
+    float* orbit = &orbits[0][0][0];
+    float* model = &models[0][0][0];
+    for (std::size_t i = 0; i < count; ++i, orbit += 16, model += 16)
+    {
+        float c = co[i], s = so[i];
+
+        // spin inside the tilted frame
+        float a0x = cs[i] * t00[i] - ss[i] * t20[i];
+        float a0y = cs[i] * t01[i] - ss[i] * t21[i];
+        float a0z = cs[i] * t02[i] - ss[i] * t22[i];
+        float a2x = ss[i] * t00[i] + cs[i] * t20[i];
+        float a2y = ss[i] * t01[i] + cs[i] * t21[i];
+        float a2z = ss[i] * t02[i] + cs[i] * t22[i];
+
+        float tx = c * d[i] + ox[i];
+        float ty = oy[i];
+        float tz = -s * d[i] + oz[i];
+
+        // orbit frame
+        orbit[0] = c;    orbit[1] = 0.0f; orbit[2] = -s;   orbit[3] = 0.0f;
+        orbit[4] = 0.0f; orbit[5] = 1.0f; orbit[6] = 0.0f; orbit[7] = 0.0f;
+        orbit[8] = s;    orbit[9] = 0.0f; orbit[10] = c;   orbit[11] = 0.0f;
+        orbit[12] = tx;  orbit[13] = ty;  orbit[14] = tz;  orbit[15] = 1.0f;
+
+        // model = orbit frame * tilt * spin
+        model[0] = c * a0x + s * a0z;
+        model[1] = a0y;
+        model[2] = -s * a0x + c * a0z;
+        model[3] = 0.0f;
+        model[4] = c * t10[i] + s * t12[i];
+        model[5] = t11[i];
+        model[6] = -s * t10[i] + c * t12[i];
+        model[7] = 0.0f;
+        model[8] = c * a2x + s * a2z;
+        model[9] = a2y;
+        model[10] = -s * a2x + c * a2z;
+        model[11] = 0.0f;
+        model[12] = tx;
+        model[13] = ty;
+        model[14] = tz;
+        model[15] = 1.0f;
+    }
+}
+
+
+// same translation as the orbit matrices, in double precision, one body at a time since only
+// the drawn bodies need it
+void BodyTransformBatch::composePositions()
+{
+    const std::size_t count = exactOrbitAngles.size();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        double angle = exactOrbitAngles[i];
+        double distance = exactDistances[i];
+        positions[i] = glm::dvec3(std::cos(angle) * distance, 0.0, -std::sin(angle) * distance) + exactOffsets[i];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// compare with the glm chain, then time both paths over the same inputs
+///////////////////////////////////////////////////////////////////////////////
+int benchmarkBodyTransforms(int count)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int FRAMES = 100;
+
+    if (count <= 0)
+        count = 10000;
+
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> angle(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> distance(0.0f, 100.0f);
+    std::uniform_real_distribution<float> axis(0.0f, 180.0f);
+
+    std::vector<float> orbitAngle(count), orbitDistance(count), rotationAxis(count), spinAngle(count);
+    BodyTransformBatch batch;
+    batch.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        orbitAngle[i] = angle(random);
+        orbitDistance[i] = distance(random);
+        rotationAxis[i] = axis(random);
+        spinAngle[i] = angle(random);
+        batch.add(rotationAxis[i]);
+        batch.set(i, orbitAngle[i], orbitDistance[i], spinAngle[i]);
+    }
+
+    // equivalence, relative to the scale of each matrix (unit rotation, translation up to distance)
+    std::vector<glm::mat4> reference(count);
+    batch.compose();
+    float maxError = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        reference[i] = bodyModelReference(orbitAngle[i], orbitDistance[i], rotationAxis[i], spinAngle[i]);
+        for (int col = 0; col < 4; ++col)
+            for (int row = 0; row < 4; ++row)
+            {
+                float expected = reference[i][col][row];
+                float error = std::fabs(batch.getModel(i)[col][row] - expected) / std::fmax(1.0f, orbitDistance[i]);
+                maxError = std::fmax(maxError, error);
+            }
+    }
+
+    // glm chain
+    float checksum = 0.0f;
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (int i = 0; i < count; ++i)
+            reference[i] = bodyModelReference(orbitAngle[i] + frame, orbitDistance[i], rotationAxis[i], spinAngle[i] + frame);
+        checksum += reference[frame % count][3][0];
+    }
+    double chainMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES;
+
+    // closed form
+    start = Clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (int i = 0; i < count; ++i)
+            batch.set(i, orbitAngle[i] + frame, orbitDistance[i], spinAngle[i] + frame);
+        batch.compose();
+        checksum += batch.getModel(frame % count)[3][0];
+    }
+    double kernelMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES;
+
+    bool equivalent = maxError < 1e-5f;
+    std::cout << "Body transforms: " << count << " bodies, " << FRAMES << " frames (checksum " << checksum << ")\n"
+        << "  glm rotate chain: " << chainMs << " ms/frame, " << chainMs * 1e6 / count << " ns/body\n"
+        << "  closed form:      " << kernelMs << " ms/frame, " << kernelMs * 1e6 / count << " ns/body\n"
+        << "  speedup: " << chainMs / kernelMs << "x, max relative error: " << maxError
+        << (equivalent ? "" : " (MISMATCH)") << std::endl;
+    return equivalent ? 0 : 1;
+}
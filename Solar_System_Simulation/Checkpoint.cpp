@@ -0,0 +1,247 @@
+#include <header/Checkpoint.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const char CHECKPOINT_MAGIC[8] = { 'S', 'O', 'L', 'A', 'R', 'C', 'H', 'K' };
+const uint32_t CHECKPOINT_VERSION = 2;      // 2: double camera position
+const std::size_t MAX_PENDING_CHECKPOINTS = 16;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// 64-bit FNV-1a
+///////////////////////////////////////////////////////////////////////////////
+static uint64_t checksum(const void* data, std::size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write to a temporary file first so a crash never leaves a truncated checkpoint
+///////////////////////////////////////////////////////////////////////////////
+bool writeCheckpoint(const char* path, const CheckpointData& data)
+{
+    CheckpointHeader header;
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.size = sizeof(CheckpointData);
+    header.checksum = checksum(&data, sizeof(data));
+
+    std::string temporary = std::string(path) + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(&data, sizeof(data), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    std::remove(path);
+    return std::rename(temporary.c_str(), path) == 0;
+}
+
+bool readCheckpoint(const char* path, CheckpointData& data)
+{
+    FILE* file = std::fopen(path, "rb");
+    if (!file)
+    {
+        std::cout << "ERROR::CHECKPOINT::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    CheckpointHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0
+        && header.version == CHECKPOINT_VERSION
+        && header.size == sizeof(CheckpointData)
+        && std::fread(&data, sizeof(data), 1, file) == 1
+        && header.checksum == checksum(&data, sizeof(data));
+    std::fclose(file);
+
+    if (!ok)
+        std::cout << "ERROR::CHECKPOINT::INVALID_FILE: " << path << std::endl;
+    return ok;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor, the worker thread starts with the first checkpoint
+///////////////////////////////////////////////////////////////////////////////
+CheckpointWriter::CheckpointWriter() : busy(false), stopping(false), written(0), replaced(0), failed(0)
+{
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// queue a copy of the data, replacing a pending checkpoint of the same path
+///////////////////////////////////////////////////////////////////////////////
+void CheckpointWriter::submit(const char* path, const CheckpointData& data)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!worker.joinable())
+            worker = std::thread(&CheckpointWriter::work, this);
+
+        for (;;)
+        {
+            for (std::size_t i = 0; i < jobs.size(); ++i)
+            {
+                if (jobs[i].path == path)
+                {
+                    jobs[i].data = data;
+                    ++replaced;
+                    return;
+                }
+            }
+            if (jobs.size() < MAX_PENDING_CHECKPOINTS)
+                break;
+            // disk cannot keep up, every pending path is another scenario's newest checkpoint
+            space.wait(lock);
+        }
+        Job job;
+        job.path = path;
+        job.data = data;
+        jobs.push_back(job);
+    }
+    wake.notify_one();
+}
+
+void CheckpointWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+}
+
+void CheckpointWriter::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+            break;
+
+        Job job = jobs.front();
+        jobs.pop_front();
+        busy = true;
+        space.notify_all();
+
+        lock.unlock();
+        bool ok = writeCheckpoint(job.path.c_str(), job.data);
+        if (!ok)
+            std::cout << "ERROR::CHECKPOINT::FILE_NOT_SUCCESSFULLY_WRITTEN: " << job.path << std::endl;
+        lock.lock();
+
+        busy = false;
+        if (ok)
+            ++written;
+        else
+            ++failed;
+        if (jobs.empty())
+            idle.notify_all();
+    }
+    idle.notify_all();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// continue a batch checkpoint for a number of steps, optionally checking the result
+// bit for bit against a checkpoint written later by the original run
+///////////////////////////////////////////////////////////////////////////////
+int runReplay(int argc, char** argv)
+{
+    const char* path = NULL;
+    const char* comparePath = NULL;
+    uint64_t steps = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+            steps = std::strtoull(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            comparePath = argv[++i];
+    }
+
+    CheckpointData data;
+    if (!path || !readCheckpoint(path, data))
+    {
+        std::cout << "usage: --replay <checkpoint> [--steps N] [--compare <checkpoint>]" << std::endl;
+        return -1;
+    }
+    if (!data.hasSimulation)
+    {
+        std::cout << "Checkpoint " << path << " has no simulation state" << std::endl;
+        return -1;
+    }
+
+    Simulation simulation;
+    simulation.setState(data.simulation);
+
+    CheckpointData expected;
+    if (comparePath)
+    {
+        if (!readCheckpoint(comparePath, expected) || !expected.hasSimulation
+            || expected.simulation.step < data.simulation.step)
+        {
+            std::cout << "Checkpoint " << comparePath << " cannot be compared with " << path << std::endl;
+            return -1;
+        }
+        steps = expected.simulation.step - data.simulation.step;
+    }
+
+    simulation.run(steps);
+    const SimulationState& state = simulation.getState();
+    std::cout.precision(17);
+    std::cout << "Replayed " << data.scenario << " from step " << data.simulation.step << " to " << state.step
+        << " (day " << state.day << ", energy " << simulation.energy() << ")" << std::endl;
+
+    if (!comparePath)
+        return 0;
+
+    if (std::memcmp(&state, &expected.simulation, sizeof(SimulationState)) == 0)
+    {
+        std::cout << "Bit-exact match with " << comparePath << std::endl;
+        return 0;
+    }
+
+    double maxDifference = 0.0;
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+        for (int k = 0; k < 3; ++k)
+            maxDifference = std::fmax(maxDifference, std::fabs(state.position[i][k] - expected.simulation.position[i][k]));
+    std::cout << "MISMATCH with " << comparePath << ", max position difference " << maxDifference << " AU" << std::endl;
+    return 1;
+}
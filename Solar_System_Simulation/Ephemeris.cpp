@@ -0,0 +1,354 @@
+#include <header/Ephemeris.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// constants //////////////////////////////////////////////////////////////////
+const char EPHEMERIS_MAGIC[8] = { 'S', 'O', 'L', 'A', 'R', 'E', 'P', 'H' };
+const uint32_t EPHEMERIS_VERSION = 1;
+const int CHEBYSHEV_DEGREE = 10;
+const int SEGMENTS_PER_ORBIT = 16;
+
+// Keplerian elements and rates per Julian century, valid 1800 AD - 2050 AD
+// (Standish, "Keplerian Elements for Approximate Positions of the Major Planets")
+// a (AU), e, I (deg), L (deg), longitude of perihelion (deg), longitude of ascending node (deg)
+struct OrbitalElements
+{
+    double a, e, I, L, peri, node;
+    double aRate, eRate, IRate, LRate, periRate, nodeRate;
+};
+
+static const OrbitalElements PLANET_ELEMENTS[EPH_BODY_COUNT] = {
+    // Mercury
+    { 0.38709927, 0.20563593, 7.00497902, 252.25032350, 77.45779628, 48.33076593,
+      0.00000037, 0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081 },
+    // Venus
+    { 0.72333566, 0.00677672, 3.39467605, 181.97909950, 131.60246718, 76.67984255,
+      0.00000390, -0.00004107, -0.00078890, 58517.81538729, 0.00268329, -0.27769418 },
+    // Earth-Moon barycenter
+    { 1.00000261, 0.01671123, -0.00001531, 100.46457166, 102.93768193, 0.0,
+      0.00000562, -0.00004392, -0.01294668, 35999.37244981, 0.32327364, 0.0 },
+    // Mars
+    { 1.52371034, 0.09339410, 1.84969142, -4.55343205, -23.94362959, 49.55953891,
+      0.00001847, 0.00007882, -0.00813131, 19140.30268499, 0.44441088, -0.29257343 },
+    // Jupiter
+    { 5.20288700, 0.04838624, 1.30439695, 34.39644051, 14.72847983, 100.47390909,
+      -0.00011607, -0.00013253, -0.00183714, 3034.74612775, 0.21252668, 0.20469106 },
+    // Saturn
+    { 9.53667594, 0.05386179, 2.48599187, 49.95424423, 92.59887831, 113.66242448,
+      -0.00125060, -0.00050991, 0.00193609, 1222.49362201, -0.41897216, -0.28867794 },
+    // Uranus
+    { 19.18916464, 0.04725744, 0.77263783, 313.23810451, 170.95427630, 74.01692503,
+      -0.00196176, -0.00004397, -0.00242939, 428.48202785, 0.40805281, 0.04240589 },
+    // Neptune
+    { 30.06992276, 0.00859048, 1.77004347, -55.12002969, 44.96476227, 131.78422574,
+      0.00026291, 0.00005105, 0.00035372, 218.45945325, -0.32241464, -0.00508664 }
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// solve Kepler's equation and rotate the orbital plane into the ecliptic
+///////////////////////////////////////////////////////////////////////////////
+glm::dvec3 keplerPosition(int body, double day)
+{
+    const double DEG = 3.14159265358979323846 / 180.0;
+    const OrbitalElements& el = PLANET_ELEMENTS[body];
+    double T = day / 36525.0;
+
+    double a = el.a + el.aRate * T;
+    double e = el.e + el.eRate * T;
+    double I = (el.I + el.IRate * T) * DEG;
+    double L = el.L + el.LRate * T;
+    double peri = el.peri + el.periRate * T;
+    double node = el.node + el.nodeRate * T;
+
+    double w = (peri - node) * DEG;
+    double M = std::fmod(L - peri, 360.0);
+    if (M > 180.0)
+        M -= 360.0;
+    else if (M < -180.0)
+        M += 360.0;
+    M *= DEG;
+
+    // Newton iteration on E - e sin(E) = M
+    double E = M + e * std::sin(M);
+    for (int i = 0; i < 8; ++i)
+    {
+        double dE = (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+        E -= dE;
+        if (std::fabs(dE) < 1e-14)
+            break;
+    }
+
+    // position in the orbital plane
+    double xp = a * (std::cos(E) - e);
+    double yp = a * std::sqrt(1.0 - e * e) * std::sin(E);
+
+    double cw = std::cos(w), sw = std::sin(w);
+    double cO = std::cos(node * DEG), sO = std::sin(node * DEG);
+    double cI = std::cos(I), sI = std::sin(I);
+
+    return glm::dvec3(
+        (cw * cO - sw * sO * cI) * xp + (-sw * cO - cw * sO * cI) * yp,
+        (cw * sO + sw * cO * cI) * xp + (-sw * sO + cw * cO * cI) * yp,
+        (sw * sI) * xp + (cw * sI) * yp);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write Chebyshev segments of every planet to a binary file
+// each segment is fitted at the Chebyshev nodes of its own [start, start + segmentDays]
+///////////////////////////////////////////////////////////////////////////////
+bool buildEphemeris(const char* path, double startDay, double endDay)
+{
+    if (endDay <= startDay)
+    {
+        std::cout << "ERROR::EPHEMERIS::INVALID_RANGE: " << startDay << " - " << endDay << std::endl;
+        return false;
+    }
+
+    const double PI = 3.14159265358979323846;
+    const int n = CHEBYSHEV_DEGREE + 1;
+
+    EphemerisHeader header;
+    std::memcpy(header.magic, EPHEMERIS_MAGIC, sizeof(header.magic));
+    header.version = EPHEMERIS_VERSION;
+    header.bodyCount = EPH_BODY_COUNT;
+    header.startDay = startDay;
+    header.endDay = endDay;
+
+    EphemerisBodyRecord records[EPH_BODY_COUNT];
+    uint64_t offset = sizeof(EphemerisHeader) + sizeof(records);
+    for (int body = 0; body < EPH_BODY_COUNT; ++body)
+    {
+        // orbital period from Kepler's third law
+        double periodDays = 365.25 * std::pow(PLANET_ELEMENTS[body].a, 1.5);
+        EphemerisBodyRecord& record = records[body];
+        record.body = body;
+        record.degree = CHEBYSHEV_DEGREE;
+        record.segmentDays = periodDays / SEGMENTS_PER_ORBIT;
+        record.segmentCount = (uint32_t)std::ceil((endDay - startDay) / record.segmentDays);
+        record.reserved = 0;
+        record.coeffOffset = offset;
+        offset += (uint64_t)record.segmentCount * 3 * n * sizeof(double);
+    }
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+    {
+        std::cout << "ERROR::EPHEMERIS::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fwrite(records, sizeof(records), 1, file);
+
+    std::vector<double> samples(3 * n);
+    std::vector<double> coeffs(3 * n);
+    for (int body = 0; body < EPH_BODY_COUNT; ++body)
+    {
+        const EphemerisBodyRecord& record = records[body];
+        double half = record.segmentDays * 0.5;
+        for (uint32_t s = 0; s < record.segmentCount; ++s)
+        {
+            double mid = startDay + s * record.segmentDays + half;
+
+            // sample at the Chebyshev nodes
+            for (int k = 0; k < n; ++k)
+            {
+                double x = std::cos(PI * (k + 0.5) / n);
+                glm::dvec3 p = keplerPosition(body, mid + x * half);
+                samples[k] = p.x;
+                samples[n + k] = p.y;
+                samples[2 * n + k] = p.z;
+            }
+
+            // discrete Chebyshev transform
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (int j = 0; j < n; ++j)
+                {
+                    double sum = 0.0;
+                    for (int k = 0; k < n; ++k)
+                        sum += samples[axis * n + k] * std::cos(PI * j * (k + 0.5) / n);
+                    coeffs[axis * n + j] = (j == 0 ? 1.0 : 2.0) * sum / n;
+                }
+            }
+            std::fwrite(coeffs.data(), sizeof(double), coeffs.size(), file);
+        }
+    }
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    if (ok)
+        std::cout << "Ephemeris written to " << path << " (" << offset << " bytes)" << std::endl;
+    return ok;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+Ephemeris::Ephemeris() : data(NULL), size(0), header(NULL)
+#ifdef _WIN32
+    , fileHandle(NULL), mappingHandle(NULL)
+#endif
+{
+    std::memset(records, 0, sizeof(records));
+}
+
+Ephemeris::~Ephemeris()
+{
+    close();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// map the file and validate header and body records
+///////////////////////////////////////////////////////////////////////////////
+bool Ephemeris::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = (std::size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(NULL, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+    size = (std::size_t)st.st_size;
+#endif
+    data = (const unsigned char*)view;
+
+    // validate
+    bool valid = size >= sizeof(EphemerisHeader);
+    if (valid)
+    {
+        header = (const EphemerisHeader*)data;
+        valid = std::memcmp(header->magic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC)) == 0
+            && header->version == EPHEMERIS_VERSION
+            && header->bodyCount == EPH_BODY_COUNT
+            && size >= sizeof(EphemerisHeader) + EPH_BODY_COUNT * sizeof(EphemerisBodyRecord);
+    }
+    for (int body = 0; valid && body < EPH_BODY_COUNT; ++body)
+    {
+        const EphemerisBodyRecord* record = (const EphemerisBodyRecord*)(data + sizeof(EphemerisHeader)) + body;
+        uint64_t bytes = (uint64_t)record->segmentCount * 3 * (record->degree + 1) * sizeof(double);
+        valid = record->body == (uint32_t)body && record->segmentCount > 0 && record->segmentDays > 0.0
+            && record->coeffOffset + bytes <= size;
+        records[body] = record;
+    }
+
+    if (!valid)
+    {
+        std::cout << "ERROR::EPHEMERIS::INVALID_FILE: " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Ephemeris::close()
+{
+    if (data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE)mappingHandle);
+        CloseHandle((HANDLE)fileHandle);
+        mappingHandle = NULL;
+        fileHandle = NULL;
+#else
+        munmap((void*)data, size);
+#endif
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+    std::memset(records, 0, sizeof(records));
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// pick the segment directly from the day and evaluate with Clenshaw's recurrence
+///////////////////////////////////////////////////////////////////////////////
+glm::dvec3 Ephemeris::position(int body, double day) const
+{
+    if (!data || body < 0 || body >= EPH_BODY_COUNT)
+        return glm::dvec3(0.0);
+
+    const EphemerisBodyRecord* record = records[body];
+    double offset = day - header->startDay;
+    if (offset < 0.0)
+        offset = 0.0;
+    uint32_t segment = (uint32_t)(offset / record->segmentDays);
+    if (segment >= record->segmentCount)
+        segment = record->segmentCount - 1;
+
+    // normalized time inside the segment, [-1, 1]
+    double x = (offset - segment * record->segmentDays) / record->segmentDays * 2.0 - 1.0;
+    if (x > 1.0)
+        x = 1.0;
+
+    int n = record->degree + 1;
+    const double* c = (const double*)(data + record->coeffOffset) + (std::size_t)segment * 3 * n;
+
+    glm::dvec3 result;
+    for (int axis = 0; axis < 3; ++axis, c += n)
+    {
+        double b1 = 0.0, b2 = 0.0;
+        for (int j = n - 1; j >= 1; --j)
+        {
+            double b0 = 2.0 * x * b1 - b2 + c[j];
+            b2 = b1;
+            b1 = b0;
+        }
+        result[axis] = x * b1 - b2 + c[0];
+    }
+    return result;
+}
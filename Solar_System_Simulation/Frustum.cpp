@@ -0,0 +1,82 @@
+#include <header/Frustum.h>
+
+#include <cmath>
+#include <cstddef>
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// planes from the rows of the clip matrix (Gribb and Hartmann)
+///////////////////////////////////////////////////////////////////////////////
+void extractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    // glm is column-major, row r is (m[0][r], m[1][r], m[2][r], m[3][r])
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f)
+            planes[i] /= length;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// one plane against every sphere, branch-free so it vectorizes
+///////////////////////////////////////////////////////////////////////////////
+static void cullPlane(const glm::vec4& plane, const float* __restrict x, const float* __restrict y,
+    const float* __restrict z, const float* __restrict r, unsigned char* __restrict inside, std::size_t count)
+{
+    float a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float distance = a * x[i] + b * y[i] + c * z[i] + d;
+        inside[i] &= (unsigned char)(distance >= -r[i]);
+    }
+}
+
+void FrustumCuller::resize(unsigned int count)
+{
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    radii.resize(count);
+    inside.resize(count);
+}
+
+unsigned int FrustumCuller::cull(const glm::mat4& viewProjection, std::vector<int>& visible)
+{
+    std::size_t count = radii.size();
+    visible.clear();
+    if (count == 0)
+        return 0;
+
+    glm::vec4 planes[6];
+    extractFrustumPlanes(viewProjection, planes);
+
+    unsigned char* flags = &inside[0];
+    for (std::size_t i = 0; i < count; ++i)
+        flags[i] = 1;
+    for (int p = 0; p < 6; ++p)
+        cullPlane(planes[p], &centerX[0], &centerY[0], &centerZ[0], &radii[0], flags, count);
+
+    // compaction, ordered so draws keep the body order
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (flags[i])
+            visible.push_back((int)i);
+    }
+    return (unsigned int)visible.size();
+}
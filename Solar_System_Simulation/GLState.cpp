@@ -0,0 +1,224 @@
+#include <header/GLState.h>
+
+#include <cstddef>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const GLenum CACHED_CAPABILITIES[GL_STATE_CAPABILITIES] = { GL_BLEND, GL_DEPTH_TEST, GL_PROGRAM_POINT_SIZE, GL_RASTERIZER_DISCARD };
+
+GLStateCache glState;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+GLStateCache::GLStateCache() : bufferBytes(0), textureBytes(0)
+{
+    invalidate();
+    frame.issued = frame.skipped = frame.draws = frame.triangles = 0;
+    lastFrame = frame;
+}
+
+void GLStateCache::invalidate()
+{
+    program = vertexArray = activeUnit = -1;
+    for (unsigned int i = 0; i < GL_STATE_TEXTURE_UNITS; ++i)
+        textures2D[i] = textureBuffers[i] = -1;
+    for (unsigned int i = 0; i < GL_STATE_CAPABILITIES; ++i)
+        capabilities[i] = -1;
+    depthWrite = colorWrite = -1;
+    blendSource = blendDestination = -1;
+}
+
+void GLStateCache::beginFrame()
+{
+    lastFrame = frame;
+    frame.issued = frame.skipped = frame.draws = frame.triangles = 0;
+}
+
+void GLStateCache::countDraw(GLenum mode, unsigned int count, unsigned int instances)
+{
+    ++frame.draws;
+    if (mode == GL_TRIANGLES)
+        frame.triangles += count / 3 * instances;
+    else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+        frame.triangles += (count - 2) * instances;
+}
+
+bool GLStateCache::changes(int& cached, int value)
+{
+    if (cached == value)
+    {
+        ++frame.skipped;
+        return false;
+    }
+    cached = value;
+    ++frame.issued;
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// bindings
+///////////////////////////////////////////////////////////////////////////////
+void GLStateCache::useProgram(unsigned int program)
+{
+    if (changes(this->program, (int)program))
+        glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(unsigned int vertexArray)
+{
+    if (changes(this->vertexArray, (int)vertexArray))
+        glBindVertexArray(vertexArray);
+}
+
+void GLStateCache::activeTexture(unsigned int unit)
+{
+    if (changes(activeUnit, (int)unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+// the active unit only changes when a binding does, a texture already on its unit costs nothing
+void GLStateCache::bindTexture(int textureUnit, GLenum target, unsigned int texture)
+{
+    unsigned int unit = (unsigned int)(textureUnit - GL_TEXTURE0);
+    int* cached = NULL;
+    if (unit < GL_STATE_TEXTURE_UNITS && target == GL_TEXTURE_2D)
+        cached = &textures2D[unit];
+    else if (unit < GL_STATE_TEXTURE_UNITS && target == GL_TEXTURE_BUFFER)
+        cached = &textureBuffers[unit];
+
+    if (cached && *cached == (int)texture)
+    {
+        ++frame.skipped;
+        return;
+    }
+    activeTexture(unit);
+    if (cached)
+        *cached = (int)texture;
+    ++frame.issued;
+    glBindTexture(target, texture);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// fixed-function state
+///////////////////////////////////////////////////////////////////////////////
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    unsigned int i = 0;
+    while (i < GL_STATE_CAPABILITIES && CACHED_CAPABILITIES[i] != capability)
+        ++i;
+    if (i < GL_STATE_CAPABILITIES && !changes(capabilities[i], enabled ? 1 : 0))
+        return;
+    if (i == GL_STATE_CAPABILITIES)
+        ++frame.issued;
+
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLStateCache::depthMask(bool write)
+{
+    if (changes(depthWrite, write ? 1 : 0))
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::colorMask(bool write)
+{
+    GLboolean mask = write ? GL_TRUE : GL_FALSE;
+    if (changes(colorWrite, write ? 1 : 0))
+        glColorMask(mask, mask, mask, mask);
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination)
+{
+    if (blendSource == (int)source && blendDestination == (int)destination)
+    {
+        ++frame.skipped;
+        return;
+    }
+    blendSource = (int)source;
+    blendDestination = (int)destination;
+    ++frame.issued;
+    glBlendFunc(source, destination);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// deleting a bound object binds 0 in GL, the cache does the same
+///////////////////////////////////////////////////////////////////////////////
+void GLStateCache::deleteProgram(unsigned int program)
+{
+    // a program in use stays current until another is used, so the name cannot come back yet
+    // but useProgram must not skip a new program that happens to get it after that
+    if (this->program == (int)program)
+        this->program = -1;
+    glDeleteProgram(program);
+}
+
+void GLStateCache::deleteVertexArray(unsigned int vertexArray)
+{
+    if (this->vertexArray == (int)vertexArray)
+        this->vertexArray = 0;
+    glDeleteVertexArrays(1, &vertexArray);
+}
+
+void GLStateCache::deleteTexture(unsigned int texture)
+{
+    for (unsigned int i = 0; i < GL_STATE_TEXTURE_UNITS; ++i)
+    {
+        if (textures2D[i] == (int)texture)
+            textures2D[i] = 0;
+        if (textureBuffers[i] == (int)texture)
+            textureBuffers[i] = 0;
+    }
+    textureStorage(texture, 0);
+    glDeleteTextures(1, &texture);
+}
+
+void GLStateCache::deleteBuffer(unsigned int buffer)
+{
+    std::map<unsigned int, std::size_t>::iterator it = bufferSizes.find(buffer);
+    if (it != bufferSizes.end())
+    {
+        bufferBytes -= it->second;
+        bufferSizes.erase(it);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// GPU memory, as the application asked for it, drivers may pad and keep copies
+///////////////////////////////////////////////////////////////////////////////
+void GLStateCache::bufferData(unsigned int buffer, GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    glBufferData(target, size, data, usage);
+    std::size_t& bytes = bufferSizes[buffer];
+    bufferBytes += (std::size_t)size - bytes;
+    bytes = (std::size_t)size;
+}
+
+void GLStateCache::textureStorage(unsigned int texture, std::size_t bytes)
+{
+    std::map<unsigned int, std::size_t>::iterator it = textureSizes.find(texture);
+    if (it != textureSizes.end())
+    {
+        textureBytes -= it->second;
+        textureSizes.erase(it);
+    }
+    if (bytes)
+    {
+        textureSizes[texture] = bytes;
+        textureBytes += bytes;
+    }
+}
@@ -0,0 +1,349 @@
+#include <header/GLTrace.h>
+
+GLCallTracer glTrace;
+
+#ifdef SOLAR_GL_TRACE
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+
+// constants //////////////////////////////////////////////////////////////////
+enum GLCallKind
+{
+    GL_CALL_PLAIN,              // counted
+    GL_CALL_TIMED,              // counted and timed
+    GL_CALL_CREATES             // counted, reported when called inside a frame after the first
+};
+
+// Every GL function the application calls, without the gl prefix. glGetError is left out,
+// the wrappers call it after each of these.
+#define GL_TRACE_FUNCTIONS(X) \
+    X(ActiveTexture, GL_CALL_PLAIN) \
+    X(AttachShader, GL_CALL_PLAIN) \
+    X(BeginConditionalRender, GL_CALL_PLAIN) \
+    X(BeginQuery, GL_CALL_PLAIN) \
+    X(BeginTransformFeedback, GL_CALL_PLAIN) \
+    X(BindBuffer, GL_CALL_PLAIN) \
+    X(BindBufferBase, GL_CALL_PLAIN) \
+    X(BindFramebuffer, GL_CALL_PLAIN) \
+    X(BindRenderbuffer, GL_CALL_PLAIN) \
+    X(BindTexture, GL_CALL_PLAIN) \
+    X(BindVertexArray, GL_CALL_PLAIN) \
+    X(BlendFunc, GL_CALL_PLAIN) \
+    X(BufferData, GL_CALL_TIMED) \
+    X(BufferSubData, GL_CALL_TIMED) \
+    X(CheckFramebufferStatus, GL_CALL_PLAIN) \
+    X(ClientWaitSync, GL_CALL_TIMED) \
+    X(Clear, GL_CALL_PLAIN) \
+    X(ClearColor, GL_CALL_PLAIN) \
+    X(ColorMask, GL_CALL_PLAIN) \
+    X(CompileShader, GL_CALL_TIMED) \
+    X(CreateProgram, GL_CALL_CREATES) \
+    X(CreateShader, GL_CALL_CREATES) \
+    X(DeleteBuffers, GL_CALL_PLAIN) \
+    X(DeleteFramebuffers, GL_CALL_PLAIN) \
+    X(DeleteProgram, GL_CALL_PLAIN) \
+    X(DeleteQueries, GL_CALL_PLAIN) \
+    X(DeleteRenderbuffers, GL_CALL_PLAIN) \
+    X(DeleteShader, GL_CALL_PLAIN) \
+    X(DeleteSync, GL_CALL_PLAIN) \
+    X(DeleteTextures, GL_CALL_PLAIN) \
+    X(DeleteVertexArrays, GL_CALL_PLAIN) \
+    X(DepthMask, GL_CALL_PLAIN) \
+    X(Disable, GL_CALL_PLAIN) \
+    X(DrawArrays, GL_CALL_PLAIN) \
+    X(DrawArraysInstanced, GL_CALL_PLAIN) \
+    X(DrawElements, GL_CALL_PLAIN) \
+    X(DrawElementsInstanced, GL_CALL_PLAIN) \
+    X(Enable, GL_CALL_PLAIN) \
+    X(EnableVertexAttribArray, GL_CALL_PLAIN) \
+    X(EndConditionalRender, GL_CALL_PLAIN) \
+    X(EndQuery, GL_CALL_PLAIN) \
+    X(EndTransformFeedback, GL_CALL_PLAIN) \
+    X(FenceSync, GL_CALL_PLAIN) \
+    X(Finish, GL_CALL_TIMED) \
+    X(FramebufferRenderbuffer, GL_CALL_PLAIN) \
+    X(GenBuffers, GL_CALL_CREATES) \
+    X(GenerateMipmap, GL_CALL_TIMED) \
+    X(GenFramebuffers, GL_CALL_CREATES) \
+    X(GenQueries, GL_CALL_CREATES) \
+    X(GenRenderbuffers, GL_CALL_CREATES) \
+    X(GenTextures, GL_CALL_CREATES) \
+    X(GenVertexArrays, GL_CALL_CREATES) \
+    X(GetInteger64v, GL_CALL_PLAIN) \
+    X(GetIntegerv, GL_CALL_PLAIN) \
+    X(GetProgramBinary, GL_CALL_TIMED) \
+    X(GetProgramInfoLog, GL_CALL_PLAIN) \
+    X(GetProgramiv, GL_CALL_PLAIN) \
+    X(GetQueryObjectiv, GL_CALL_TIMED) \
+    X(GetQueryObjectui64v, GL_CALL_TIMED) \
+    X(GetShaderInfoLog, GL_CALL_PLAIN) \
+    X(GetShaderiv, GL_CALL_PLAIN) \
+    X(GetString, GL_CALL_PLAIN) \
+    X(GetUniformLocation, GL_CALL_TIMED) \
+    X(LinkProgram, GL_CALL_TIMED) \
+    X(MapBufferRange, GL_CALL_TIMED) \
+    X(PixelStorei, GL_CALL_PLAIN) \
+    X(ProgramBinary, GL_CALL_TIMED) \
+    X(ProgramParameteri, GL_CALL_PLAIN) \
+    X(QueryCounter, GL_CALL_PLAIN) \
+    X(ReadPixels, GL_CALL_TIMED) \
+    X(RenderbufferStorage, GL_CALL_PLAIN) \
+    X(ShaderSource, GL_CALL_PLAIN) \
+    X(TexBuffer, GL_CALL_PLAIN) \
+    X(TexImage2D, GL_CALL_TIMED) \
+    X(TexParameteri, GL_CALL_PLAIN) \
+    X(TransformFeedbackVaryings, GL_CALL_PLAIN) \
+    X(Uniform1f, GL_CALL_PLAIN) \
+    X(Uniform1i, GL_CALL_PLAIN) \
+    X(Uniform2f, GL_CALL_PLAIN) \
+    X(Uniform2fv, GL_CALL_PLAIN) \
+    X(Uniform3f, GL_CALL_PLAIN) \
+    X(Uniform3fv, GL_CALL_PLAIN) \
+    X(Uniform4f, GL_CALL_PLAIN) \
+    X(Uniform4fv, GL_CALL_PLAIN) \
+    X(UniformMatrix2fv, GL_CALL_PLAIN) \
+    X(UniformMatrix3fv, GL_CALL_PLAIN) \
+    X(UniformMatrix4fv, GL_CALL_PLAIN) \
+    X(UnmapBuffer, GL_CALL_PLAIN) \
+    X(UseProgram, GL_CALL_PLAIN) \
+    X(VertexAttribDivisor, GL_CALL_PLAIN) \
+    X(VertexAttribPointer, GL_CALL_PLAIN) \
+    X(Viewport, GL_CALL_PLAIN)
+
+enum GLTraceFunction
+{
+#define GL_TRACE_ENUM(function, kind) GL_TRACE_##function,
+    GL_TRACE_FUNCTIONS(GL_TRACE_ENUM)
+#undef GL_TRACE_ENUM
+    GL_TRACE_FUNCTION_COUNT
+};
+
+// the driver's glGetError, never wrapped
+static PFNGLGETERRORPROC driverGetError = NULL;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// wrappers
+///////////////////////////////////////////////////////////////////////////////
+// Counts the call when made, times it and checks for an error when the wrapper returns
+template <int Function, GLCallKind Kind>
+class GLCallCheck
+{
+public:
+    GLCallCheck() : traced(glTrace.isTracedThread())
+    {
+        if (!traced)
+            return;
+        glTrace.recordCall(Function);
+        if (Kind == GL_CALL_TIMED)
+            start = std::chrono::steady_clock::now();
+    }
+
+    ~GLCallCheck()
+    {
+        if (!traced)
+            return;
+        if (Kind == GL_CALL_TIMED)
+            glTrace.recordTime(Function, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        GLenum error = driverGetError();
+        if (error != GL_NO_ERROR)
+            glTrace.recordError(Function, error);
+    }
+
+private:
+    bool traced;
+    std::chrono::steady_clock::time_point start;
+};
+
+// One wrapper per function, with the same signature as glad's pointer
+template <int Function, GLCallKind Kind, typename Proc>
+struct GLHook;
+
+template <int Function, GLCallKind Kind, typename R, typename... Args>
+struct GLHook<Function, Kind, R (APIENTRYP)(Args...)>
+{
+    static R (APIENTRYP original)(Args...);
+
+    static R APIENTRY call(Args... args)
+    {
+        GLCallCheck<Function, Kind> check;
+        return original(args...);
+    }
+};
+
+template <int Function, GLCallKind Kind, typename R, typename... Args>
+R (APIENTRYP GLHook<Function, Kind, R (APIENTRYP)(Args...)>::original)(Args...) = NULL;
+
+// puts the wrapper in glad's pointer, unless it is already there or the driver lacks the function
+template <int Function, GLCallKind Kind, typename Proc>
+static void hook(Proc& pointer)
+{
+    typedef GLHook<Function, Kind, Proc> Hook;
+    if (pointer == NULL || pointer == &Hook::call)
+        return;
+    Hook::original = pointer;
+    pointer = &Hook::call;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+GLCallTracer::GLCallTracer() : stats(GL_TRACE_FUNCTION_COUNT), frames(0), inFrame(false)
+{
+#define GL_TRACE_STATS(function, kind) \
+    stats[GL_TRACE_##function].name = "gl" #function; \
+    stats[GL_TRACE_##function].timed = kind == GL_CALL_TIMED; \
+    stats[GL_TRACE_##function].creates = kind == GL_CALL_CREATES;
+    GL_TRACE_FUNCTIONS(GL_TRACE_STATS)
+#undef GL_TRACE_STATS
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// installing, counting starts anew for the new context
+///////////////////////////////////////////////////////////////////////////////
+void GLCallTracer::install()
+{
+    driverGetError = glad_glGetError;
+#define GL_TRACE_HOOK(function, kind) hook<GL_TRACE_##function, kind>(glad_gl##function);
+    GL_TRACE_FUNCTIONS(GL_TRACE_HOOK)
+#undef GL_TRACE_HOOK
+
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        GLCallStats& s = stats[i];
+        s.calls = s.setupCalls = 0;
+        s.frameCalls = s.maxFrameCalls = 0;
+        s.ms = 0.0;
+        s.errors = 0;
+        s.flagged = false;
+    }
+    frames = 0;
+    inFrame = false;
+    owner = std::this_thread::get_id();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// frames
+///////////////////////////////////////////////////////////////////////////////
+void GLCallTracer::beginFrame()
+{
+    inFrame = true;
+}
+
+void GLCallTracer::endFrame()
+{
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        stats[i].maxFrameCalls = std::max(stats[i].maxFrameCalls, stats[i].frameCalls);
+        stats[i].frameCalls = 0;
+    }
+    ++frames;
+    inFrame = false;
+}
+
+void GLCallTracer::recordCall(int function)
+{
+    GLCallStats& s = stats[function];
+    if (!inFrame)
+    {
+        ++s.setupCalls;
+        return;
+    }
+    ++s.calls;
+    ++s.frameCalls;
+
+    // the first frame creates what is made on first use, later ones should not
+    if (s.creates && frames > 0 && !s.flagged)
+    {
+        s.flagged = true;
+        std::cout << "WARNING::GLTRACE::OBJECT_CREATED_IN_FRAME: " << s.name << " in frame " << frames << std::endl;
+    }
+}
+
+void GLCallTracer::recordError(int function, unsigned int error)
+{
+    GLCallStats& s = stats[function];
+    if (s.errors++ == 0)
+    {
+        std::cout << "ERROR::GLTRACE::GL_ERROR: 0x" << std::hex << error << std::dec << " after " << s.name;
+        if (inFrame)
+            std::cout << " in frame " << frames << std::endl;
+        else
+            std::cout << " outside the frames" << std::endl;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// report
+///////////////////////////////////////////////////////////////////////////////
+static bool busier(const GLCallStats* a, const GLCallStats* b)
+{
+    return a->calls != b->calls ? a->calls > b->calls : a->setupCalls > b->setupCalls;
+}
+
+void GLCallTracer::printSummary() const
+{
+    std::vector<const GLCallStats*> order;
+    unsigned long long total = 0;
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        if (stats[i].calls + stats[i].setupCalls == 0)
+            continue;
+        order.push_back(&stats[i]);
+        total += stats[i].calls;
+    }
+    if (order.empty())
+        return;
+    std::sort(order.begin(), order.end(), busier);
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "GL calls of %u frames, %.1f per frame", frames, frames ? (double)total / frames : 0.0);
+    std::cout << line << "\n"
+        << "  function                   per frame     max    setup |  driver ms   per call" << std::endl;
+    for (std::size_t i = 0; i < order.size() && i < GL_TRACE_SUMMARY_FUNCTIONS; ++i)
+    {
+        const GLCallStats& s = *order[i];
+        int length = std::snprintf(line, sizeof(line), "  %-26s %9.2f %7u %8llu |", s.name,
+            frames ? (double)s.calls / frames : 0.0, s.maxFrameCalls, s.setupCalls);
+        unsigned long long calls = s.calls + s.setupCalls;
+        if (s.timed && length > 0 && length < (int)sizeof(line))
+            std::snprintf(line + length, sizeof(line) - length, " %10.3f %10.4f", s.ms, s.ms / calls);
+        std::cout << line << std::endl;
+    }
+    if (order.size() > GL_TRACE_SUMMARY_FUNCTIONS)
+        std::cout << "  " << order.size() - GL_TRACE_SUMMARY_FUNCTIONS << " more functions called, the timed ones among them:" << std::endl;
+
+    // timed functions that did not make the list above
+    for (std::size_t i = GL_TRACE_SUMMARY_FUNCTIONS; i < order.size(); ++i)
+    {
+        const GLCallStats& s = *order[i];
+        if (!s.timed)
+            continue;
+        std::snprintf(line, sizeof(line), "  %-26s %9.2f %7u %8llu | %10.3f %10.4f", s.name,
+            frames ? (double)s.calls / frames : 0.0, s.maxFrameCalls, s.setupCalls, s.ms, s.ms / (s.calls + s.setupCalls));
+        std::cout << line << std::endl;
+    }
+
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        if (stats[i].flagged)
+            std::cout << "  " << stats[i].name << " created objects inside frames after the first" << std::endl;
+        if (stats[i].errors)
+            std::cout << "  " << stats[i].name << " left a GL error " << stats[i].errors << " times" << std::endl;
+    }
+}
+#endif
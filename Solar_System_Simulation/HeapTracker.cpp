@@ -0,0 +1,387 @@
+#include <header/HeapTracker.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <intrin.h>
+#define HEAP_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define HEAP_RETURN_ADDRESS() __builtin_return_address(0)
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#define HEAP_BACKTRACE
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const std::size_t HEAP_HEADER_SIZE = 16;            // size of the block in front, keeps malloc's 16-byte alignment
+const std::size_t HEAP_FRAME_NAME = 64;             // longer function names are cut in the summary
+
+// every thread, constant-initialized so allocations before main are counted too
+static std::atomic<unsigned long long> totalAllocations(0);
+static std::atomic<long long> liveBytes(0);
+
+static thread_local bool frameThread = false;       // the render thread inside a frame
+static thread_local bool inTracker = false;         // allocations of the tracker itself are not counted
+static thread_local int currentTag = PROFILE_FRAME;
+
+HeapTracker heapTracker;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// replaced global operator new and delete
+///////////////////////////////////////////////////////////////////////////////
+static void* allocate(std::size_t size, void* caller)
+{
+    char* block = (char*)std::malloc(size + HEAP_HEADER_SIZE);
+    if (block == NULL)
+        return NULL;
+    *(std::size_t*)block = size;
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    liveBytes.fetch_add((long long)size, std::memory_order_relaxed);
+    if (frameThread && !inTracker)
+        heapTracker.recordFrameAllocation(size, caller);
+    return block + HEAP_HEADER_SIZE;
+}
+
+static void release(void* pointer)
+{
+    if (pointer == NULL)
+        return;
+    char* block = (char*)pointer - HEAP_HEADER_SIZE;
+    std::size_t size = *(std::size_t*)block;
+    liveBytes.fetch_sub((long long)size, std::memory_order_relaxed);
+    if (frameThread && !inTracker)
+        heapTracker.recordFrameFree(size);
+    std::free(block);
+}
+
+void* operator new(std::size_t size)
+{
+    void* pointer = allocate(size, HEAP_RETURN_ADDRESS());
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* pointer = allocate(size, HEAP_RETURN_ADDRESS());
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, HEAP_RETURN_ADDRESS());
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, HEAP_RETURN_ADDRESS());
+}
+
+void operator delete(void* pointer) noexcept                            { release(pointer); }
+void operator delete[](void* pointer) noexcept                          { release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept     { release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept   { release(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept               { release(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept             { release(pointer); }
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// call stacks
+///////////////////////////////////////////////////////////////////////////////
+// module of a return address, NULL when unknown
+static void* moduleOf(void* address)
+{
+#if defined(_WIN32)
+    HMODULE module = NULL;
+    GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)address, &module);
+    return (void*)module;
+#elif defined(HEAP_BACKTRACE)
+    Dl_info info;
+    return dladdr(address, &info) ? info.dli_fbase : NULL;
+#else
+    return NULL;
+#endif
+}
+
+static void* executableModule = NULL;
+static void* runtimeModule = NULL;                  // the C++ standard library, the executable when linked in
+
+// past the frames of the standard library, the first frame tells whose allocation it is:
+// the executable's or a library's, the GL driver above all
+static bool fromDriver(void* const* stack, unsigned int depth)
+{
+    for (unsigned int i = 0; i < depth; ++i)
+    {
+        void* module = moduleOf(stack[i]);
+        if (module != runtimeModule || module == executableModule)
+            return module != executableModule;
+    }
+    return false;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+HeapTracker::HeapTracker()
+{
+    reset();
+}
+
+void HeapTracker::reset()
+{
+    frames = 0;
+    frameAllocations = frameFrees = 0;
+    frameApplicationAllocations = 0;
+    frameBytes = 0;
+    lastFrameAllocations = 0;
+    maxFrameAllocations = maxFrame = 0;
+    steadyAllocatingFrames = 0;
+    steadyAllocations = steadyBytes = 0;
+    steadyDriverAllocations = 0;
+    frameTotalAllocations = frameTotalFrees = 0;
+    for (int i = 0; i < PROFILE_STAGE_COUNT; ++i)
+        tags[i].allocations = tags[i].bytes = 0;
+    std::memset(sites, 0, sizeof(sites));
+    siteCount = 0;
+    unsitedAllocations = 0;
+
+    executableModule = moduleOf((void*)&moduleOf);
+    runtimeModule = moduleOf((void*)&std::set_new_handler);
+#ifdef HEAP_BACKTRACE
+    // the first backtrace loads the unwinder, better here than inside a frame
+    void* stack[1];
+    backtrace(stack, 1);
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// frames
+///////////////////////////////////////////////////////////////////////////////
+void HeapTracker::beginFrame()
+{
+    frameAllocations = frameFrees = 0;
+    frameApplicationAllocations = 0;
+    frameBytes = 0;
+    frameThread = true;
+}
+
+void HeapTracker::endFrame()
+{
+    frameThread = false;
+    lastFrameAllocations = frameAllocations;
+    if (frameAllocations > maxFrameAllocations)
+    {
+        maxFrameAllocations = frameAllocations;
+        maxFrame = frames;
+    }
+    if (frames >= HEAP_WARMUP_FRAMES && frameApplicationAllocations > 0)
+        ++steadyAllocatingFrames;
+    ++frames;
+}
+
+int HeapTracker::setTag(int tag)
+{
+    int previous = currentTag;
+    currentTag = tag;
+    return previous;
+}
+
+unsigned long long HeapTracker::getTotalAllocations()
+{
+    return totalAllocations.load(std::memory_order_relaxed);
+}
+
+long long HeapTracker::getLiveBytes()
+{
+    return liveBytes.load(std::memory_order_relaxed);
+}
+
+void HeapTracker::recordFrameAllocation(std::size_t bytes, void* caller)
+{
+    ++frameAllocations;
+    frameBytes += bytes;
+    ++frameTotalAllocations;
+    if (frames < HEAP_WARMUP_FRAMES)
+        return;
+
+    int tag = currentTag >= 0 && currentTag < PROFILE_STAGE_COUNT ? currentTag : PROFILE_FRAME;
+    ++tags[tag].allocations;
+    tags[tag].bytes += bytes;
+    ++steadyAllocations;
+    steadyBytes += bytes;
+    if (recordSite(bytes, tag, caller))
+        ++steadyDriverAllocations;
+    else
+        ++frameApplicationAllocations;
+}
+
+void HeapTracker::recordFrameFree(std::size_t)
+{
+    ++frameFrees;
+    ++frameTotalFrees;
+}
+
+// the call stack from the caller of operator new on, sites are told apart by all of it
+bool HeapTracker::recordSite(std::size_t bytes, int tag, void* caller)
+{
+    inTracker = true;
+    void* stack[HEAP_SITE_DEPTH + 4];
+    unsigned int depth = 0;
+#if defined(_WIN32)
+    depth = CaptureStackBackTrace(0, HEAP_SITE_DEPTH + 4, stack, NULL);
+#elif defined(HEAP_BACKTRACE)
+    depth = (unsigned int)backtrace(stack, HEAP_SITE_DEPTH + 4);
+#endif
+    // frames of the tracker go, unless operator new was inlined and its caller is not there
+    unsigned int first = 0;
+    while (first < depth && stack[first] != caller)
+        ++first;
+    if (first == depth)
+    {
+        stack[0] = caller;
+        first = 0;
+        depth = 1;
+    }
+    depth = std::min(depth - first, HEAP_SITE_DEPTH);
+
+    std::size_t hash = 0;
+    for (unsigned int i = 0; i < depth; ++i)
+        hash = hash * 31 + (std::size_t)stack[first + i];
+
+    for (unsigned int probe = 0; probe < HEAP_MAX_SITES; ++probe)
+    {
+        HeapSite& site = sites[(hash + probe) % HEAP_MAX_SITES];
+        if (site.depth == 0)
+        {
+            if (siteCount * 4 >= HEAP_MAX_SITES * 3)
+                break;                              // nearly full, probing would get long
+            std::memcpy(site.stack, stack + first, depth * sizeof(void*));
+            site.depth = depth;
+            site.tag = tag;
+            site.driver = fromDriver(site.stack, depth);
+            ++siteCount;
+        }
+        else if (site.depth != depth || std::memcmp(site.stack, stack + first, depth * sizeof(void*)) != 0)
+        {
+            continue;
+        }
+        ++site.allocations;
+        site.bytes += bytes;
+        inTracker = false;
+        return site.driver;
+    }
+    ++unsitedAllocations;
+    bool driver = fromDriver(stack + first, depth);
+    inTracker = false;
+    return driver;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// report
+///////////////////////////////////////////////////////////////////////////////
+// function of a return address, the module and offset for addr2line when it has no symbol
+static std::string describeFrame(void* address)
+{
+    char text[64];
+#ifdef HEAP_BACKTRACE
+    Dl_info info;
+    if (dladdr(address, &info) && info.dli_fname)
+    {
+        if (info.dli_sname)
+        {
+            int status = -1;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+            std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+            std::free(demangled);
+            name = name.substr(0, name.find('('));
+            return name.size() > HEAP_FRAME_NAME ? name.substr(0, HEAP_FRAME_NAME - 3) + "..." : name;
+        }
+        const char* module = std::strrchr(info.dli_fname, '/');
+        std::snprintf(text, sizeof(text), "+0x%lx", (unsigned long)((char*)address - (char*)info.dli_fbase));
+        return std::string(module ? module + 1 : info.dli_fname) + text;
+    }
+#endif
+    std::snprintf(text, sizeof(text), "%p", address);
+    return text;
+}
+
+static bool busier(const HeapSite* a, const HeapSite* b)
+{
+    return a->allocations > b->allocations;
+}
+
+void HeapTracker::printSummary() const
+{
+    if (frames == 0)
+        return;
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "Heap: %u frames, %.1f allocations and %.1f frees per frame, at most %u allocations (frame %u), %.1f MB live",
+        frames, (double)frameTotalAllocations / frames, (double)frameTotalFrees / frames, maxFrameAllocations, maxFrame,
+        getLiveBytes() / (1024.0 * 1024.0));
+    std::cout << line << std::endl;
+    if (frames <= HEAP_WARMUP_FRAMES)
+        return;
+
+    unsigned int steadyFrames = frames - HEAP_WARMUP_FRAMES;
+    std::snprintf(line, sizeof(line), "  after the first %u frames: %u of %u frames allocated, %llu allocations, %llu bytes, %llu of them in the driver",
+        HEAP_WARMUP_FRAMES, steadyAllocatingFrames, steadyFrames, steadyAllocations, steadyBytes, steadyDriverAllocations);
+    std::cout << line << std::endl;
+    if (steadyAllocations == 0)
+        return;
+
+    std::cout << "  stage          allocs/frame  bytes/frame" << std::endl;
+    for (int s = 0; s < PROFILE_STAGE_COUNT; ++s)
+    {
+        if (tags[s].allocations == 0)
+            continue;
+        std::snprintf(line, sizeof(line), "  %-12s %14.2f %12.1f", FrameProfiler::stageName(s),
+            (double)tags[s].allocations / steadyFrames, (double)tags[s].bytes / steadyFrames);
+        std::cout << line << std::endl;
+    }
+
+    std::vector<const HeapSite*> order;
+    for (unsigned int i = 0; i < HEAP_MAX_SITES; ++i)
+        if (sites[i].depth)
+            order.push_back(&sites[i]);
+    std::sort(order.begin(), order.end(), busier);
+    std::cout << "  busiest sites: allocs      bytes  stage        call stack" << std::endl;
+    for (std::size_t i = 0; i < order.size() && i < HEAP_SUMMARY_SITES; ++i)
+    {
+        const HeapSite& site = *order[i];
+        std::snprintf(line, sizeof(line), "  %14llu %10llu  %-12s", site.allocations, site.bytes, FrameProfiler::stageName(site.tag));
+        std::cout << line << (site.driver ? " (driver)" : "");
+        for (unsigned int f = 0; f < site.depth && f < 4; ++f)
+            std::cout << (f ? " < " : " ") << describeFrame(site.stack[f]);
+        std::cout << std::endl;
+    }
+    if (unsitedAllocations)
+        std::cout << "  " << unsitedAllocations << " allocations at sites past the first " << siteCount << std::endl;
+}
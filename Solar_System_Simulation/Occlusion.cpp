@@ -0,0 +1,192 @@
+#include <header/Occlusion.h>
+#include <header/camera.h>
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+OcclusionCuller::OcclusionCuller() : proxyShader(NULL), proxyVAO(0), proxyVBO(0), eye(0.0f), issued(0), occluded(0)
+{
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    destroy();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// one query per body, the proxy is the impostor quad, which lies in front of the
+// whole sphere and covers its silhouette
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionCuller::resize(unsigned int count)
+{
+    // nothing to create for no bodies, destroy() runs from the destructor after the context is gone
+    if (proxyShader == NULL && count > 0)
+    {
+        const float corners[] = { -1.0f, -1.0f,   1.0f, -1.0f,   -1.0f, 1.0f,   1.0f, 1.0f };
+        proxyShader = new Shader("body.vs", "occlusion.fs", NULL, "IMPOSTOR");
+        proxyShader->use();
+        proxyShader->setVec2("logDepth", LogDepthParameters());
+        glGenVertexArrays(1, &proxyVAO);
+        glGenBuffers(1, &proxyVBO);
+        glState.bindVertexArray(proxyVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, proxyVBO);
+        glState.bufferData(proxyVBO, GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glState.bindVertexArray(0);
+    }
+
+    while (bodies.size() < count)
+    {
+        BodyQuery body;
+        glGenQueries(1, &body.query);
+        body.pending = false;
+        body.hidden = false;
+        body.mode = DRAW_PLAIN;
+        body.conditional = false;
+        bodies.push_back(body);
+    }
+    while (bodies.size() > count)
+    {
+        glDeleteQueries(1, &bodies.back().query);
+        bodies.pop_back();
+    }
+}
+
+void OcclusionCuller::destroy()
+{
+    resize(0);
+    if (proxyShader == NULL)
+        return;
+
+    glState.deleteProgram(proxyShader->ID);
+    glState.deleteVertexArray(proxyVAO);
+    glState.deleteBuffer(proxyVBO);
+    delete proxyShader;
+    proxyShader = NULL;
+    proxyVAO = proxyVBO = 0;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// per frame
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionCuller::beginFrame(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& eyePosition)
+{
+    issued = 0;
+    occluded = 0;
+    eye = eyePosition;
+
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        BodyQuery& body = bodies[i];
+        if (body.pending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(body.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLint anySamples = 0;
+                glGetQueryObjectiv(body.query, GL_QUERY_RESULT, &anySamples);
+                body.hidden = anySamples == 0;
+                body.pending = false;
+            }
+        }
+        // counted from the finished queries, not from the conditional draws: the GPU may
+        // still draw a conditional body whose proxy turned out visible
+        if (body.hidden)
+            ++occluded;
+    }
+
+    if (proxyShader)
+    {
+        proxyShader->use();
+        proxyShader->setMat4("projection", projection);
+        proxyShader->setMat4("view", view);
+        proxyShader->setVec3("viewPos", eye);
+    }
+}
+
+void OcclusionCuller::beginBody(int index, const glm::vec3& center, float radius)
+{
+    BodyQuery& body = bodies[index];
+
+    // from inside the bounding sphere the proxy is meaningless
+    if (glm::length(center - eye) <= radius)
+        body.hidden = false;
+    body.conditional = body.hidden;
+
+    if (body.hidden)
+    {
+        if (!body.pending)
+        {
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, body.query);
+            drawProxy(center, radius);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            body.pending = true;
+            ++issued;
+        }
+        // no wait: if the GPU has no answer yet the body is simply drawn
+        glBeginConditionalRender(body.query, GL_QUERY_NO_WAIT);
+        body.mode = DRAW_CONDITIONAL;
+    }
+    else if (!body.pending)
+    {
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, body.query);
+        body.pending = true;
+        body.mode = DRAW_QUERIED;
+        ++issued;
+    }
+    else
+    {
+        body.mode = DRAW_PLAIN;
+    }
+}
+
+void OcclusionCuller::endBody(int index)
+{
+    BodyQuery& body = bodies[index];
+    if (body.mode == DRAW_CONDITIONAL)
+        glEndConditionalRender();
+    else if (body.mode == DRAW_QUERIED)
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+    body.mode = DRAW_PLAIN;
+}
+
+void OcclusionCuller::resumeBody(int index)
+{
+    // the query was already issued by beginBody, only the conditional part applies again
+    BodyQuery& body = bodies[index];
+    if (body.conditional)
+    {
+        glBeginConditionalRender(body.query, GL_QUERY_NO_WAIT);
+        body.mode = DRAW_CONDITIONAL;
+    }
+}
+
+void OcclusionCuller::reset(int index)
+{
+    bodies[index].hidden = false;
+    bodies[index].conditional = false;
+}
+
+void OcclusionCuller::drawProxy(const glm::vec3& center, float radius)
+{
+    proxyShader->use();
+    proxyShader->setVec3("center", center);
+    proxyShader->setFloat("radius", radius);
+
+    glState.colorMask(false);
+    glState.depthMask(false);
+    glState.bindVertexArray(proxyVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glState.countDraw(GL_TRIANGLE_STRIP, 4);
+    glState.depthMask(true);
+    glState.colorMask(true);
+}
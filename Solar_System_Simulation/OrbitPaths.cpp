@@ -0,0 +1,198 @@
+#include <header/OrbitPaths.h>
+#include <header/camera.h>
+#include <header/Ephemeris.h>
+#include <header/Profiler.h>
+
+#include <cmath>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int ORBIT_POINT_COUNT = ORBIT_SEGMENTS + 1;
+const unsigned int ORBIT_INSTANCE_FLOATS = 8;
+const int ORBIT_POINT_UNIT = 15;            // texture unit of the point buffer, clear of the body textures
+
+enum { PATH_NONE, PATH_CIRCLE, PATH_KEPLER };
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+OrbitPaths::OrbitPaths() : shader(NULL), pointBuffer(0), pointTexture(0), instanceBuffer(0), vertexArray(0), uploads(0)
+{
+}
+
+OrbitPaths::~OrbitPaths()
+{
+    destroy();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the points live in a buffer texture indexed by orbit and vertex, the instance
+// records are plain per-instance attributes, no vertex buffer is needed
+///////////////////////////////////////////////////////////////////////////////
+bool OrbitPaths::create(unsigned int orbitCount)
+{
+    destroy();
+    if (orbitCount == 0)
+        return false;
+
+    PathKey none = { PATH_NONE, -1, 0.0, 0.0, 0.0f };
+    paths.assign(orbitCount, none);
+    points.assign(orbitCount * ORBIT_POINT_COUNT * 4, 0.0f);
+    instances.assign(orbitCount * ORBIT_INSTANCE_FLOATS, 0.0f);
+
+    shader = new Shader("orbit.vs", "line.fs", "line.gs");
+    shader->use();
+    shader->setInt("points", ORBIT_POINT_UNIT);
+    shader->setInt("pointCount", (int)ORBIT_POINT_COUNT);
+    shader->setVec2("logDepth", LogDepthParameters());
+
+    glGenBuffers(1, &pointBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, pointBuffer);
+    glState.bufferData(pointBuffer, GL_TEXTURE_BUFFER, points.size() * sizeof(float), &points[0], GL_STATIC_DRAW);
+    glGenTextures(1, &pointTexture);
+    glState.bindTexture(GL_TEXTURE0 + ORBIT_POINT_UNIT, GL_TEXTURE_BUFFER, pointTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, pointBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &instanceBuffer);
+    glState.bindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glState.bufferData(instanceBuffer, GL_ARRAY_BUFFER, instances.size() * sizeof(float), &instances[0], GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, ORBIT_INSTANCE_FLOATS * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, ORBIT_INSTANCE_FLOATS * sizeof(float), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glState.bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void OrbitPaths::destroy()
+{
+    if (shader == NULL)
+        return;
+
+    glState.deleteVertexArray(vertexArray);
+    glState.deleteBuffer(instanceBuffer);
+    glState.deleteTexture(pointTexture);
+    glState.deleteBuffer(pointBuffer);
+    glState.deleteProgram(shader->ID);
+    delete shader;
+
+    shader = NULL;
+    pointBuffer = pointTexture = instanceBuffer = vertexArray = 0;
+    paths.clear();
+    points.clear();
+    instances.clear();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// paths, generated on the CPU and uploaded only when the key changed
+///////////////////////////////////////////////////////////////////////////////
+bool OrbitPaths::setCircle(int orbit, float radius)
+{
+    PathKey key = { PATH_CIRCLE, -1, 0.0, 0.0, radius };
+    return upload(orbit, key);
+}
+
+bool OrbitPaths::setKepler(int orbit, int ephemerisBody, double epochDay, double periodDays, float auScale)
+{
+    PathKey key = { PATH_KEPLER, ephemerisBody, epochDay, periodDays, auScale };
+    return upload(orbit, key);
+}
+
+bool OrbitPaths::upload(int orbit, const PathKey& key)
+{
+    PathKey& old = paths[orbit];
+    if (old.kind == key.kind && old.ephemerisBody == key.ephemerisBody && old.epochDay == key.epochDay
+        && old.periodDays == key.periodDays && old.size == key.size)
+        return false;
+    old = key;
+
+    const double TWO_PI = 6.283185307179586;
+    float* point = &points[orbit * ORBIT_POINT_COUNT * 4];
+    for (unsigned int i = 0; i < ORBIT_POINT_COUNT; ++i, point += 4)
+    {
+        // the last point closes the loop on the first
+        double fraction = (double)(i % ORBIT_SEGMENTS) / ORBIT_SEGMENTS;
+        glm::dvec3 p(0.0);
+        if (key.kind == PATH_CIRCLE)
+        {
+            // same parametrization as the orbit matrices of BodyTransformBatch
+            double angle = TWO_PI * fraction;
+            p = glm::dvec3(std::cos(angle), 0.0, -std::sin(angle)) * (double)key.size;
+        }
+        else if (key.kind == PATH_KEPLER)
+        {
+            // ecliptic (x, y, z) in AU to scene (x, z, -y), as for the planets
+            glm::dvec3 ecliptic = keplerPosition(key.ephemerisBody, key.epochDay + fraction * key.periodDays) * (double)key.size;
+            p = glm::dvec3(ecliptic.x, ecliptic.z, -ecliptic.y);
+        }
+        point[0] = (float)p.x;
+        point[1] = (float)p.y;
+        point[2] = (float)p.z;
+        point[3] = (float)(i == ORBIT_SEGMENTS ? 1.0 : fraction);
+    }
+
+    const std::size_t offset = orbit * ORBIT_POINT_COUNT * 4;
+    glBindBuffer(GL_TEXTURE_BUFFER, pointBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, offset * sizeof(float), ORBIT_POINT_COUNT * 4 * sizeof(float), &points[offset]);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    ++uploads;
+    return true;
+}
+
+void OrbitPaths::setPlacement(int orbit, const glm::vec3& parentCenter, float phase, const glm::vec4& color)
+{
+    float* instance = &instances[orbit * ORBIT_INSTANCE_FLOATS];
+    instance[0] = parentCenter.x;
+    instance[1] = parentCenter.y;
+    instance[2] = parentCenter.z;
+    instance[3] = phase;
+    instance[4] = color.r;
+    instance[5] = color.g;
+    instance[6] = color.b;
+    instance[7] = color.a;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// every orbit in one call: an instance per orbit, a line strip through its points
+// blended without depth writes, call it with the other transparent draws
+///////////////////////////////////////////////////////////////////////////////
+void OrbitPaths::draw(const glm::mat4& projection, const glm::mat4& view, const glm::vec2& viewport, float lineWidth)
+{
+    if (shader == NULL)
+        return;
+    ProfileScope scope(PROFILE_ORBITS);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(float), &instances[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shader->use();
+    shader->setMat4("projection", projection);
+    shader->setMat4("view", view);
+    shader->setVec2("viewport", viewport);
+    shader->setFloat("lineWidth", lineWidth);
+    glState.bindTexture(GL_TEXTURE0 + ORBIT_POINT_UNIT, GL_TEXTURE_BUFFER, pointTexture);
+
+    glState.enable(GL_BLEND);
+    glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.depthMask(false);
+    glState.bindVertexArray(vertexArray);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, ORBIT_POINT_COUNT, (GLsizei)paths.size());
+    glState.countDraw(GL_LINE_STRIP, ORBIT_POINT_COUNT, (unsigned int)paths.size());
+    glState.depthMask(true);
+    glState.disable(GL_BLEND);
+}
@@ -0,0 +1,296 @@
+#include <header/Overlay.h>
+#include <header/Profiler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const float OVERLAY_SCALE = 2.0f;                   // screen pixels per font pixel
+const float OVERLAY_MARGIN = 8.0f;
+const float OVERLAY_PADDING = 6.0f;
+const float OVERLAY_LINE_HEIGHT = 9.0f * OVERLAY_SCALE;
+const float OVERLAY_ADVANCE = 6.0f * OVERLAY_SCALE;
+const unsigned int OVERLAY_COLUMNS = 30;            // characters per line
+const unsigned int OVERLAY_GRAPH_FRAMES = 120;
+const float OVERLAY_BAR_WIDTH = 3.0f;
+const float OVERLAY_GRAPH_HEIGHT = 48.0f;
+const float OVERLAY_GRAPH_MS = 33.3f;               // top of the graph
+const float OVERLAY_TARGET_MS = 16.7f;              // line across the graph
+const unsigned int OVERLAY_MAX_QUADS = 1024;
+
+const unsigned int OVERLAY_BACKGROUND = 0x000000b0;
+const unsigned int OVERLAY_TEXT = 0xe0e0e0ff;
+const unsigned int OVERLAY_GOOD = 0x50d050ff;
+const unsigned int OVERLAY_SLOW = 0xe0c040ff;
+const unsigned int OVERLAY_BAD = 0xe05040ff;
+const unsigned int OVERLAY_TARGET = 0xffffff60;
+
+// 5x7 font, a row per byte from the top, bit 4 is the left column
+const char OVERLAY_GLYPHS[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%";
+const unsigned int OVERLAY_GLYPH_COUNT = sizeof(OVERLAY_GLYPHS) - 1;
+const unsigned char OVERLAY_FONT[OVERLAY_GLYPH_COUNT][7] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // space
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },   // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },   // 9
+    { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 },   // A
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },   // Z
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },   // .
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },   // :
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },   // /
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },   // -
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }    // %
+};
+
+// atlas: the glyphs in 6x8 cells side by side, then one solid cell for plain quads
+const unsigned int OVERLAY_CELL_WIDTH = 6, OVERLAY_CELL_HEIGHT = 8;
+const unsigned int OVERLAY_ATLAS_WIDTH = OVERLAY_CELL_WIDTH * (OVERLAY_GLYPH_COUNT + 1);
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+PerformanceOverlay::PerformanceOverlay() : shader(NULL), vertexArray(0), vertexBuffer(0), indexBuffer(0), atlas(0),
+    visible(false)
+{
+}
+
+PerformanceOverlay::~PerformanceOverlay()
+{
+    // GL objects go in destroy, while the context is alive
+}
+
+void PerformanceOverlay::create()
+{
+    shader = new Shader("overlay.vs", "overlay.fs");
+    shader->use();
+    shader->setInt("atlas", 0);
+
+    unsigned char pixels[OVERLAY_CELL_HEIGHT][OVERLAY_ATLAS_WIDTH];
+    std::memset(pixels, 0, sizeof(pixels));
+    for (unsigned int g = 0; g < OVERLAY_GLYPH_COUNT; ++g)
+        for (unsigned int row = 0; row < 7; ++row)
+            for (unsigned int column = 0; column < 5; ++column)
+                if (OVERLAY_FONT[g][row] & (0x10 >> column))
+                    pixels[row][g * OVERLAY_CELL_WIDTH + column] = 255;
+    for (unsigned int row = 0; row < OVERLAY_CELL_HEIGHT; ++row)
+        std::memset(&pixels[row][OVERLAY_GLYPH_COUNT * OVERLAY_CELL_WIDTH], 255, OVERLAY_CELL_WIDTH);
+
+    glGenTextures(1, &atlas);
+    glState.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, OVERLAY_ATLAS_WIDTH, OVERLAY_CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glState.textureStorage(atlas, sizeof(pixels));
+
+    // four corners per quad, the two triangles of every quad come from a fixed index buffer
+    std::vector<unsigned short> indices(OVERLAY_MAX_QUADS * 6);
+    for (unsigned int q = 0; q < OVERLAY_MAX_QUADS; ++q)
+    {
+        const unsigned short corners[6] = { 0, 1, 2, 2, 1, 3 };
+        for (unsigned int i = 0; i < 6; ++i)
+            indices[q * 6 + i] = (unsigned short)(q * 4 + corners[i]);
+    }
+
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glState.bindVertexArray(vertexArray);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glState.bufferData(indexBuffer, GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glState.bufferData(vertexBuffer, GL_ARRAY_BUFFER, OVERLAY_MAX_QUADS * 4 * sizeof(OverlayVertex), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayVertex), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glState.bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    vertices.reserve(OVERLAY_MAX_QUADS * 4);
+}
+
+void PerformanceOverlay::destroy()
+{
+    if (shader == NULL)
+        return;
+    glState.deleteVertexArray(vertexArray);
+    glState.deleteBuffer(vertexBuffer);
+    glState.deleteBuffer(indexBuffer);
+    glState.deleteTexture(atlas);
+    glState.deleteProgram(shader->ID);
+    delete shader;
+
+    shader = NULL;
+    vertexArray = vertexBuffer = indexBuffer = atlas = 0;
+    std::vector<OverlayVertex>().swap(vertices);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// quads
+///////////////////////////////////////////////////////////////////////////////
+void PerformanceOverlay::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned int color)
+{
+    if (vertices.size() + 4 > OVERLAY_MAX_QUADS * 4)
+        return;
+
+    OverlayVertex corners[4] = {
+        { x0, y0, u0, v0, {} }, { x1, y0, u1, v0, {} }, { x0, y1, u0, v1, {} }, { x1, y1, u1, v1, {} }
+    };
+    for (int i = 0; i < 4; ++i)
+    {
+        corners[i].color[0] = (unsigned char)(color >> 24);
+        corners[i].color[1] = (unsigned char)(color >> 16);
+        corners[i].color[2] = (unsigned char)(color >> 8);
+        corners[i].color[3] = (unsigned char)color;
+    }
+    vertices.insert(vertices.end(), corners, corners + 4);
+}
+
+void PerformanceOverlay::addRect(float x0, float y0, float x1, float y1, unsigned int color)
+{
+    float u = (OVERLAY_GLYPH_COUNT * OVERLAY_CELL_WIDTH + 0.5f * OVERLAY_CELL_WIDTH) / OVERLAY_ATLAS_WIDTH;
+    addQuad(x0, y0, x1, y1, u, 0.5f, u, 0.5f, color);
+}
+
+static int glyphIndex(char c)
+{
+    if (c >= '0' && c <= '9')
+        return 1 + (c - '0');
+    if (c >= 'A' && c <= 'Z')
+        return 11 + (c - 'A');
+    if (c >= 'a' && c <= 'z')
+        return 11 + (c - 'a');
+    const char* found = std::strchr(OVERLAY_GLYPHS, c);
+    return found && c ? (int)(found - OVERLAY_GLYPHS) : 0;
+}
+
+void PerformanceOverlay::addText(float x, float y, const char* text, unsigned int color)
+{
+    for (; *text; ++text, x += OVERLAY_ADVANCE)
+    {
+        int glyph = glyphIndex(*text);
+        if (glyph == 0)
+            continue;
+        float u0 = (float)(glyph * OVERLAY_CELL_WIDTH) / OVERLAY_ATLAS_WIDTH;
+        float u1 = (float)(glyph * OVERLAY_CELL_WIDTH + 5) / OVERLAY_ATLAS_WIDTH;
+        addQuad(x, y, x + 5.0f * OVERLAY_SCALE, y + 7.0f * OVERLAY_SCALE, u0, 0.0f, u1, 7.0f / OVERLAY_CELL_HEIGHT, color);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the panel: counters of the last frames as text, frame times as bars, newest on the right
+///////////////////////////////////////////////////////////////////////////////
+void PerformanceOverlay::draw(unsigned int width, unsigned int height)
+{
+    if (!visible)
+        return;
+    ProfileScope scope(PROFILE_OVERLAY);
+    if (shader == NULL)
+        create();
+
+    // means over the profiler's window, the counters of the last finished frame
+    const ProfileHistogram& frameTimes = profiler.getCpuHistogram(PROFILE_FRAME);
+    float frameMs = frameTimes.getMean();
+    float cpuMs = std::max(0.0f, frameMs - profiler.getCpuHistogram(PROFILE_SWAP).getMean());
+    float gpuMs = profiler.getGpuHistogram(PROFILE_FRAME).getMean();
+    float simulationMs = profiler.getCpuHistogram(PROFILE_SIMULATION).getMean() + profiler.getCpuHistogram(PROFILE_MATRICES).getMean();
+    float overlayMs = profiler.getCpuHistogram(PROFILE_OVERLAY).getMean();
+    const GLStateCounters& counters = glState.getLastFrameCounters();
+    const float MB = 1.0f / (1024.0f * 1024.0f);
+
+    const unsigned int LINES = 6;
+    char lines[LINES][48];
+    std::snprintf(lines[0], sizeof(lines[0]), "FPS %.1f  FRAME %.2f MS", frameMs > 0.0f ? 1000.0f / frameMs : 0.0f, frameMs);
+    std::snprintf(lines[1], sizeof(lines[1]), "CPU %.2f MS  GPU %.2f MS", cpuMs, gpuMs);
+    std::snprintf(lines[2], sizeof(lines[2]), "SIM %.3f MS  OVERLAY %.3f MS", simulationMs, overlayMs);
+    std::snprintf(lines[3], sizeof(lines[3]), "DRAWS %u  TRIS %u", counters.draws, counters.triangles);
+    std::snprintf(lines[4], sizeof(lines[4]), "STATE %u  SKIPPED %u", counters.issued, counters.skipped);
+    std::snprintf(lines[5], sizeof(lines[5]), "TEX %.1f MB  BUF %.1f MB", glState.getTextureBytes() * MB, glState.getBufferBytes() * MB);
+
+    float left = OVERLAY_MARGIN, top = OVERLAY_MARGIN;
+    float panelWidth = 2.0f * OVERLAY_PADDING + std::max(OVERLAY_COLUMNS * OVERLAY_ADVANCE, OVERLAY_GRAPH_FRAMES * OVERLAY_BAR_WIDTH);
+    float graphTop = top + OVERLAY_PADDING + LINES * OVERLAY_LINE_HEIGHT + OVERLAY_PADDING;
+    float graphBottom = graphTop + OVERLAY_GRAPH_HEIGHT;
+
+    vertices.clear();
+    addRect(left, top, left + panelWidth, graphBottom + OVERLAY_PADDING, OVERLAY_BACKGROUND);
+    for (unsigned int i = 0; i < LINES; ++i)
+        addText(left + OVERLAY_PADDING, top + OVERLAY_PADDING + i * OVERLAY_LINE_HEIGHT, lines[i], OVERLAY_TEXT);
+
+    float graphRight = left + OVERLAY_PADDING + OVERLAY_GRAPH_FRAMES * OVERLAY_BAR_WIDTH;
+    unsigned int bars = std::min(OVERLAY_GRAPH_FRAMES, frameTimes.getCount());
+    for (unsigned int age = 0; age < bars; ++age)
+    {
+        float ms = frameTimes.getSample(age);
+        float x1 = graphRight - age * OVERLAY_BAR_WIDTH;
+        float y0 = graphBottom - std::min(ms / OVERLAY_GRAPH_MS, 1.0f) * OVERLAY_GRAPH_HEIGHT;
+        unsigned int color = ms <= OVERLAY_TARGET_MS ? OVERLAY_GOOD : ms <= OVERLAY_GRAPH_MS ? OVERLAY_SLOW : OVERLAY_BAD;
+        addRect(x1 - OVERLAY_BAR_WIDTH + 1.0f, y0, x1, graphBottom, color);
+    }
+    float target = graphBottom - OVERLAY_TARGET_MS / OVERLAY_GRAPH_MS * OVERLAY_GRAPH_HEIGHT;
+    addRect(left + OVERLAY_PADDING, target, graphRight, target + 1.0f, OVERLAY_TARGET);
+
+    // one upload into a fresh buffer store and one draw
+    shader->use();
+    shader->setVec2("viewport", (float)width, (float)height);
+    glState.disable(GL_DEPTH_TEST);
+    glState.depthMask(false);
+    glState.enable(GL_BLEND);
+    glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, atlas);
+    glState.bindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glState.bufferData(vertexBuffer, GL_ARRAY_BUFFER, OVERLAY_MAX_QUADS * 4 * sizeof(OverlayVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(OverlayVertex), &vertices[0]);
+    unsigned int indexCount = (unsigned int)vertices.size() / 4 * 6;
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0);
+    glState.countDraw(GL_TRIANGLES, indexCount);
+    glState.disable(GL_BLEND);
+    glState.depthMask(true);
+    glState.enable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,362 @@
+#include <header/HeapTracker.h>
+#include <header/Profiler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const char* const PROFILE_STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+    "frame", "input", "simulation", "matrices", "culling", "stars", "bodies", "belt", "orbits", "rings", "overlay", "capture", "swap"
+};
+
+FrameProfiler profiler;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// rolling histogram
+///////////////////////////////////////////////////////////////////////////////
+ProfileHistogram::ProfileHistogram()
+{
+    clear();
+}
+
+void ProfileHistogram::clear()
+{
+    for (unsigned int i = 0; i < PROFILER_HISTORY; ++i)
+        samples[i] = 0.0f;
+    for (unsigned int i = 0; i < PROFILER_BUCKETS; ++i)
+        buckets[i] = 0;
+    count = next = 0;
+    total = 0.0;
+}
+
+void ProfileHistogram::add(float ms)
+{
+    // the oldest sample leaves the window
+    if (count == PROFILER_HISTORY)
+    {
+        --buckets[bucketOf(samples[next])];
+        total -= samples[next];
+    }
+    else
+    {
+        ++count;
+    }
+    samples[next] = ms;
+    ++buckets[bucketOf(ms)];
+    total += ms;
+    next = (next + 1) % PROFILER_HISTORY;
+}
+
+float ProfileHistogram::getPercentile(float fraction) const
+{
+    if (count == 0)
+        return 0.0f;
+    float sorted[PROFILER_HISTORY];
+    std::copy(samples, samples + count, sorted);
+    unsigned int rank = (unsigned int)(fraction * count + 0.999999f);
+    rank = std::min(std::max(rank, 1u), count) - 1;
+    std::nth_element(sorted, sorted + rank, sorted + count);
+    return sorted[rank];
+}
+
+float ProfileHistogram::getMax() const
+{
+    return count ? *std::max_element(samples, samples + count) : 0.0f;
+}
+
+unsigned int ProfileHistogram::bucketOf(float ms)
+{
+    unsigned int bucket = 0;
+    float limit = bucketLimit(0);
+    while (bucket + 1 < PROFILER_BUCKETS && ms >= limit)
+    {
+        limit *= 2.0f;
+        ++bucket;
+    }
+    return bucket;
+}
+
+float ProfileHistogram::bucketLimit(unsigned int i)
+{
+    if (i + 1 >= PROFILER_BUCKETS)
+        return 1e30f;
+    return (float)(2u << i) * 0.001f;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+FrameProfiler::FrameProfiler() : current(NULL), created(false), frame(0), frameScope(-1), dropped(0),
+    gpuEpoch(0), traceNext(0), traceCount(0)
+{
+    for (unsigned int s = 0; s < PROFILER_QUERY_BUFFERS; ++s)
+    {
+        slots[s].count = 0;
+        slots[s].pending = false;
+    }
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    // the queries went with the context, destroy is called before that
+}
+
+void FrameProfiler::destroy()
+{
+    if (created)
+    {
+        for (unsigned int s = 0; s < PROFILER_QUERY_BUFFERS; ++s)
+            glDeleteQueries(PROFILER_MAX_SCOPES * 2, slots[s].queries);
+    }
+    for (unsigned int s = 0; s < PROFILER_QUERY_BUFFERS; ++s)
+    {
+        slots[s].count = 0;
+        slots[s].pending = false;
+    }
+    for (int i = 0; i < PROFILE_STAGE_COUNT; ++i)
+    {
+        cpuHistograms[i].clear();
+        gpuHistograms[i].clear();
+    }
+    current = NULL;
+    created = false;
+    frame = 0;
+    frameScope = -1;
+    dropped = 0;
+    std::vector<ProfileEvent>().swap(trace);
+    traceNext = traceCount = 0;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// frames and scopes
+///////////////////////////////////////////////////////////////////////////////
+void FrameProfiler::beginFrame()
+{
+    if (!created)
+    {
+        for (unsigned int s = 0; s < PROFILER_QUERY_BUFFERS; ++s)
+            glGenQueries(PROFILER_MAX_SCOPES * 2, slots[s].queries);
+        trace.resize(PROFILER_TRACE_EVENTS);
+
+        // GPU timestamps are moved to the CPU clock through one pair taken together
+        cpuEpoch = std::chrono::steady_clock::now();
+        glGetInteger64v(GL_TIMESTAMP, &gpuEpoch);
+        created = true;
+    }
+
+    current = &slots[frame % PROFILER_QUERY_BUFFERS];
+    if (current->pending)
+        resolve(*current, true);
+    current->count = 0;
+    frameScope = begin(PROFILE_FRAME);
+}
+
+void FrameProfiler::endFrame()
+{
+    if (!current)
+        return;
+    end(frameScope);
+
+    float totals[PROFILE_STAGE_COUNT] = {};
+    bool seen[PROFILE_STAGE_COUNT] = {};
+    for (unsigned int i = 0; i < current->count; ++i)
+    {
+        const ProfileEvent& event = current->events[i];
+        if (event.cpuEnd < 0.0)
+            continue;
+        totals[event.stage] += (float)((event.cpuEnd - event.cpuStart) * 0.001);
+        seen[event.stage] = true;
+    }
+    for (int s = 0; s < PROFILE_STAGE_COUNT; ++s)
+        if (seen[s])
+            cpuHistograms[s].add(totals[s]);
+
+    // this frame's queries are read at the end of the next one, the previous frame's now
+    current->pending = true;
+    FrameQueries& previous = slots[(frame + PROFILER_QUERY_BUFFERS - 1) % PROFILER_QUERY_BUFFERS];
+    current = NULL;
+    ++frame;
+    if (previous.pending)
+        resolve(previous, false);
+}
+
+int FrameProfiler::begin(ProfileStage stage)
+{
+    if (!current || current->count >= PROFILER_MAX_SCOPES)
+        return -1;
+
+    unsigned int scope = current->count++;
+    ProfileEvent& event = current->events[scope];
+    event.frame = frame;
+    event.stage = stage;
+    event.cpuStart = now();
+    event.cpuEnd = event.gpuStart = event.gpuEnd = -1.0;
+    glQueryCounter(current->queries[scope * 2], GL_TIMESTAMP);
+    return (int)scope;
+}
+
+void FrameProfiler::end(int scope)
+{
+    if (!current || scope < 0 || scope >= (int)current->count)
+        return;
+
+    glQueryCounter(current->queries[scope * 2 + 1], GL_TIMESTAMP);
+    current->events[scope].cpuEnd = now();
+}
+
+double FrameProfiler::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - cpuEpoch).count();
+}
+
+// read the GPU times of a recorded frame and keep its scopes for the trace
+void FrameProfiler::resolve(FrameQueries& slot, bool wait)
+{
+    slot.pending = false;
+
+    // timestamps finish in order, the frame scope ends last
+    bool available = slot.count > 0 && slot.events[0].cpuEnd >= 0.0;
+    if (available && !wait)
+    {
+        GLint ready = 0;
+        glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &ready);
+        available = ready != 0;
+        if (!available)
+            ++dropped;
+    }
+
+    float totals[PROFILE_STAGE_COUNT] = {};
+    bool seen[PROFILE_STAGE_COUNT] = {};
+    for (unsigned int i = 0; i < slot.count; ++i)
+    {
+        ProfileEvent& event = slot.events[i];
+        if (available && event.cpuEnd >= 0.0)
+        {
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+            event.gpuStart = ((GLint64)start - gpuEpoch) * 0.001;
+            event.gpuEnd = ((GLint64)end - gpuEpoch) * 0.001;
+            totals[event.stage] += (float)((event.gpuEnd - event.gpuStart) * 0.001);
+            seen[event.stage] = true;
+        }
+
+        trace[traceNext] = event;
+        traceNext = (traceNext + 1) % trace.size();
+        traceCount = std::min(traceCount + 1, trace.size());
+    }
+    for (int s = 0; s < PROFILE_STAGE_COUNT; ++s)
+        if (seen[s])
+            gpuHistograms[s].add(totals[s]);
+    slot.count = 0;
+}
+
+const char* FrameProfiler::stageName(int stage)
+{
+    return stage >= 0 && stage < PROFILE_STAGE_COUNT ? PROFILE_STAGE_NAMES[stage] : "unknown";
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// output
+///////////////////////////////////////////////////////////////////////////////
+// Chrome trace event format, complete events in microseconds
+bool FrameProfiler::writeTrace(const char* path)
+{
+    for (unsigned int s = 0; s < PROFILER_QUERY_BUFFERS; ++s)
+        if (slots[s].pending)
+            resolve(slots[s], true);
+
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "ERROR::PROFILER::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    std::size_t first = (traceNext + trace.size() - traceCount) % std::max<std::size_t>(trace.size(), 1);
+    for (std::size_t n = 0; n < traceCount; ++n)
+    {
+        const ProfileEvent& event = trace[(first + n) % trace.size()];
+        const char* name = stageName(event.stage);
+        if (event.cpuEnd >= 0.0)
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                name, event.cpuStart, event.cpuEnd - event.cpuStart, event.frame);
+        if (event.gpuEnd >= event.gpuStart && event.gpuStart >= 0.0)
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                name, event.gpuStart, event.gpuEnd - event.gpuStart, event.frame);
+    }
+    std::fprintf(file, "\n]}\n");
+
+    if (std::fclose(file) != 0)
+    {
+        std::cout << "ERROR::PROFILER::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Trace of " << traceCount << " scopes written to " << path << std::endl;
+    return true;
+}
+
+void FrameProfiler::printSummary() const
+{
+    const ProfileHistogram& frames = cpuHistograms[PROFILE_FRAME];
+    if (frames.getCount() == 0)
+        return;
+
+    char line[160];
+    std::cout << "Profile of the last " << frames.getCount() << " frames, ms\n"
+        << "  stage          cpu mean    p50    p99 |  gpu mean    p50    p99" << std::endl;
+    for (int s = 0; s < PROFILE_STAGE_COUNT; ++s)
+    {
+        const ProfileHistogram& cpu = cpuHistograms[s];
+        const ProfileHistogram& gpu = gpuHistograms[s];
+        if (cpu.getCount() == 0)
+            continue;
+        std::snprintf(line, sizeof(line), "  %-12s %10.3f %6.3f %6.3f | %9.3f %6.3f %6.3f", stageName(s),
+            cpu.getMean(), cpu.getPercentile(0.5f), cpu.getPercentile(0.99f), gpu.getMean(), gpu.getPercentile(0.5f), gpu.getPercentile(0.99f));
+        std::cout << line << std::endl;
+    }
+
+    // distribution of the whole frame on the CPU
+    std::cout << "  frame cpu histogram:";
+    for (unsigned int i = 0; i < PROFILER_BUCKETS; ++i)
+    {
+        if (frames.getBucket(i) == 0)
+            continue;
+        if (i + 1 < PROFILER_BUCKETS)
+            std::snprintf(line, sizeof(line), " <%g ms %u", ProfileHistogram::bucketLimit(i), frames.getBucket(i));
+        else
+            std::snprintf(line, sizeof(line), " more %u", frames.getBucket(i));
+        std::cout << line;
+    }
+    std::cout << std::endl;
+    if (dropped)
+        std::cout << "  GPU times not ready in time for " << dropped << " frames" << std::endl;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// scope
+///////////////////////////////////////////////////////////////////////////////
+ProfileScope::ProfileScope(ProfileStage stage) : scope(profiler.begin(stage)), heapTag(heapTracker.setTag(stage))
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+    heapTracker.setTag(heapTag);
+    profiler.end(scope);
+}
@@ -0,0 +1,502 @@
+#include <header/GLState.h>
+#include <header/Recorder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const GLuint64 RECORDER_WAIT_NS = 1000000000;       // a readback still not done after this is waited for again
+const uint32_t PNG_STORED_BLOCK = 65535;            // largest uncompressed deflate block
+const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+FrameRecorder frameRecorder;
+
+// CRC-32 of PNG chunks, filled before any recording starts
+static uint32_t crcTable[256];
+
+static void makeCrcTable()
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+// a PNG file being written, the CRC runs over the current chunk
+struct PngFile
+{
+    FILE* file;
+    uint32_t crc;
+    bool ok;
+
+    void write(const void* data, std::size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (std::size_t i = 0; i < size; ++i)
+            crc = crcTable[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+        ok = std::fwrite(data, 1, size, file) == size && ok;
+    }
+
+    void writeUint(uint32_t value)
+    {
+        unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+        write(bytes, 4);
+    }
+
+    void beginChunk(const char* type, uint32_t length)
+    {
+        writeUint(length);
+        crc = 0xffffffffu;
+        write(type, 4);
+    }
+
+    void endChunk()
+    {
+        writeUint(crc ^ 0xffffffffu);
+    }
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+FrameRecorder::FrameRecorder() : recording(false), format(RECORD_Y4M), file(NULL), width(0), height(0), dropWhenBehind(false),
+    nextPixelBuffer(0), queueHead(0), queueCount(0), freeCount(0), stopping(false), captured(0), written(0), dropped(0),
+    failed(0), maxQueueDepth(0), queueDepthTotal(0), encodeMs(0.0)
+{
+    makeCrcTable();
+    for (unsigned int i = 0; i < RECORDER_PIXEL_BUFFERS; ++i)
+    {
+        pixelBuffers[i].buffer = 0;
+        pixelBuffers[i].fence = NULL;
+        pixelBuffers[i].frame = 0;
+    }
+}
+
+// stop needs the context, a recording still running here only has its thread and file to close
+FrameRecorder::~FrameRecorder()
+{
+    if (encoder.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        frameQueued.notify_one();
+        encoder.join();
+    }
+    if (file)
+        std::fclose(file);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// recording
+///////////////////////////////////////////////////////////////////////////////
+// a PNG pattern has exactly one integer conversion, like frames/solar_%05d.png
+static bool isFramePattern(const char* path)
+{
+    const char* percent = std::strchr(path, '%');
+    if (percent == NULL)
+        return false;
+    const char* conversion = percent + 1;
+    while (*conversion >= '0' && *conversion <= '9')
+        ++conversion;
+    return (*conversion == 'd' || *conversion == 'u') && std::strchr(conversion, '%') == NULL;
+}
+
+static bool endsWith(const char* text, const char* suffix)
+{
+    std::size_t length = std::strlen(text), suffixLength = std::strlen(suffix);
+    return length >= suffixLength && std::strcmp(text + length - suffixLength, suffix) == 0;
+}
+
+bool FrameRecorder::start(const char* path, unsigned int width, unsigned int height, double fps, bool dropWhenBehind)
+{
+    stop();
+    if (endsWith(path, ".y4m"))
+        format = RECORD_Y4M;
+    else if (endsWith(path, ".rgb"))
+        format = RECORD_RAW;
+    else if (isFramePattern(path))
+        format = RECORD_PNG;
+    else
+    {
+        std::cout << "ERROR::RECORDER::UNKNOWN_FORMAT: " << path << ", use .y4m, .rgb or a PNG pattern like frame_%05d.png" << std::endl;
+        return false;
+    }
+    if (width == 0 || height == 0)
+    {
+        std::cout << "ERROR::RECORDER::EMPTY_FRAME" << std::endl;
+        return false;
+    }
+
+    if (format != RECORD_PNG)
+    {
+        file = std::fopen(path, "wb");
+        if (file == NULL)
+        {
+            std::cout << "ERROR::RECORDER::FILE_NOT_SUCCESSFULLY_OPENED: " << path << std::endl;
+            return false;
+        }
+        // 4:2:0 with JPEG's full-range BT.601, the rate as a fraction of 1000
+        if (format == RECORD_Y4M)
+            std::fprintf(file, "YUV4MPEG2 W%u H%u F%u:1000 Ip A1:1 C420jpeg\n", width, height, (unsigned int)(fps * 1000.0 + 0.5));
+    }
+    this->path = path;
+    this->width = width;
+    this->height = height;
+    this->dropWhenBehind = dropWhenBehind;
+
+    // every buffer the recording needs is made now
+    const std::size_t frameBytes = (std::size_t)width * height * 4;
+    for (unsigned int i = 0; i < RECORDER_QUEUE; ++i)
+    {
+        frames[i].resize(frameBytes);
+        freeFrames[i] = i;
+    }
+    freeCount = RECORDER_QUEUE;
+    queueHead = queueCount = 0;
+    unsigned int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    if (format == RECORD_Y4M)
+        scratch.resize((std::size_t)width * height + 2 * (std::size_t)chromaWidth * chromaHeight);
+    else if (format == RECORD_RAW)
+        scratch.resize((std::size_t)width * 3);
+    else
+        scratch.resize((std::size_t)height * (1 + (std::size_t)width * 3));
+
+    for (unsigned int i = 0; i < RECORDER_PIXEL_BUFFERS; ++i)
+    {
+        PixelBuffer& pixels = pixelBuffers[i];
+        glGenBuffers(1, &pixels.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixels.buffer);
+        glState.bufferData(pixels.buffer, GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frameBytes, NULL, GL_STREAM_READ);
+        pixels.fence = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    nextPixelBuffer = 0;
+
+    captured = written = dropped = failed = 0;
+    maxQueueDepth = 0;
+    queueDepthTotal = 0;
+    encodeMs = 0.0;
+    stopping = false;
+    encoder = std::thread(&FrameRecorder::encode, this);
+    recording = true;
+    std::cout << "Recording " << width << "x" << height << " to " << path << std::endl;
+    return true;
+}
+
+void FrameRecorder::capture()
+{
+    if (!recording)
+        return;
+
+    // the ring is full, the frame in this buffer is the oldest in flight
+    PixelBuffer& pixels = pixelBuffers[nextPixelBuffer];
+    if (pixels.fence)
+        collect(pixels, true);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixels.buffer);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pixels.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pixels.frame = captured++;
+    nextPixelBuffer = (nextPixelBuffer + 1) % RECORDER_PIXEL_BUFFERS;
+
+    // earlier readbacks the GPU is done with, oldest first so the frames stay in order
+    for (unsigned int i = 0; i + 1 < RECORDER_PIXEL_BUFFERS; ++i)
+    {
+        PixelBuffer& older = pixelBuffers[(nextPixelBuffer + i) % RECORDER_PIXEL_BUFFERS];
+        if (older.fence == NULL)
+            continue;
+        if (glClientWaitSync(older.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        collect(older, false);
+    }
+}
+
+void FrameRecorder::collect(PixelBuffer& pixels, bool wait)
+{
+    if (wait)
+    {
+        while (glClientWaitSync(pixels.fence, GL_SYNC_FLUSH_COMMANDS_BIT, RECORDER_WAIT_NS) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+    }
+    glDeleteSync(pixels.fence);
+    pixels.fence = NULL;
+
+    unsigned int index;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeCount == 0 && dropWhenBehind)
+        {
+            ++dropped;
+            return;
+        }
+        while (freeCount == 0)
+            frameFreed.wait(lock);
+        index = freeFrames[--freeCount];
+    }
+
+    const std::size_t frameBytes = frames[index].size();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixels.buffer);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)frameBytes, GL_MAP_READ_BIT);
+    if (data)
+    {
+        std::memcpy(&frames[index][0], data, frameBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (data == NULL)
+        {
+            freeFrames[freeCount++] = index;
+            ++failed;
+            return;
+        }
+        frameNumbers[index] = pixels.frame;
+        queued[(queueHead + queueCount) % RECORDER_QUEUE] = index;
+        ++queueCount;
+        maxQueueDepth = std::max(maxQueueDepth, queueCount);
+        queueDepthTotal += queueCount;
+    }
+    frameQueued.notify_one();
+}
+
+void FrameRecorder::stop()
+{
+    if (!recording)
+        return;
+
+    // frames still in flight, oldest first
+    for (unsigned int i = 0; i < RECORDER_PIXEL_BUFFERS; ++i)
+    {
+        PixelBuffer& pixels = pixelBuffers[(nextPixelBuffer + i) % RECORDER_PIXEL_BUFFERS];
+        if (pixels.fence)
+            collect(pixels, true);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameQueued.notify_one();
+    encoder.join();
+
+    for (unsigned int i = 0; i < RECORDER_PIXEL_BUFFERS; ++i)
+    {
+        glState.deleteBuffer(pixelBuffers[i].buffer);
+        pixelBuffers[i].buffer = 0;
+    }
+    if (file)
+    {
+        if (std::fclose(file) != 0)
+            ++failed;
+        file = NULL;
+    }
+    for (unsigned int i = 0; i < RECORDER_QUEUE; ++i)
+        std::vector<unsigned char>().swap(frames[i]);
+    std::vector<unsigned char>().swap(scratch);
+    recording = false;
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "Recording: %u frames written to %s, %u dropped, encoder queue mean %.2f max %u of %u, %.2f ms per frame to encode",
+        written, path.c_str(), dropped, captured > dropped ? (double)queueDepthTotal / (captured - dropped) : 0.0, maxQueueDepth, RECORDER_QUEUE,
+        written ? encodeMs / written : 0.0);
+    std::cout << line << std::endl;
+    if (failed)
+        std::cout << "ERROR::RECORDER::FRAMES_NOT_SUCCESSFULLY_WRITTEN: " << failed << std::endl;
+}
+
+unsigned int FrameRecorder::getQueueDepth()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queueCount;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// encoder thread
+///////////////////////////////////////////////////////////////////////////////
+void FrameRecorder::encode()
+{
+    for (;;)
+    {
+        unsigned int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queueCount == 0 && !stopping)
+                frameQueued.wait(lock);
+            if (queueCount == 0)
+                return;
+            index = queued[queueHead];
+            queueHead = (queueHead + 1) % RECORDER_QUEUE;
+            --queueCount;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool ok = writeFrame(&frames[index][0], frameNumbers[index]);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            encodeMs += ms;
+            if (ok)
+                ++written;
+            else
+                ++failed;
+            freeFrames[freeCount++] = index;
+        }
+        frameFreed.notify_one();
+    }
+}
+
+bool FrameRecorder::writeFrame(const unsigned char* rgba, unsigned int frame)
+{
+    if (format == RECORD_Y4M)
+        return writeY4M(rgba);
+    if (format == RECORD_RAW)
+        return writeRaw(rgba);
+    return writePNG(rgba, frame);
+}
+
+// full-range BT.601 in 8-bit fixed point, chroma averaged over 2x2 pixels; GL rows start at the bottom
+bool FrameRecorder::writeY4M(const unsigned char* rgba)
+{
+    const unsigned int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    unsigned char* luma = &scratch[0];
+    unsigned char* blue = luma + (std::size_t)width * height;
+    unsigned char* red = blue + (std::size_t)chromaWidth * chromaHeight;
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const unsigned char* source = rgba + (std::size_t)(height - 1 - y) * width * 4;
+        unsigned char* target = luma + (std::size_t)y * width;
+        for (unsigned int x = 0; x < width; ++x, source += 4)
+            target[x] = (unsigned char)((77 * source[0] + 150 * source[1] + 29 * source[2] + 128) >> 8);
+    }
+
+    for (unsigned int cy = 0; cy < chromaHeight; ++cy)
+    {
+        // the last row and column repeat for odd sizes
+        const unsigned int y0 = 2 * cy, y1 = std::min(y0 + 1, height - 1);
+        const unsigned char* row0 = rgba + (std::size_t)(height - 1 - y0) * width * 4;
+        const unsigned char* row1 = rgba + (std::size_t)(height - 1 - y1) * width * 4;
+        for (unsigned int cx = 0; cx < chromaWidth; ++cx)
+        {
+            const unsigned int x0 = 2 * cx * 4, x1 = std::min(2 * cx + 1, width - 1) * 4;
+            int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+            int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+            int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+            std::size_t i = (std::size_t)cy * chromaWidth + cx;
+            blue[i] = (unsigned char)((-43 * r - 85 * g + 128 * b + (128 << 10) + 512) >> 10);
+            red[i] = (unsigned char)((128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10);
+        }
+    }
+
+    bool ok = std::fwrite("FRAME\n", 1, 6, file) == 6;
+    return std::fwrite(&scratch[0], 1, scratch.size(), file) == scratch.size() && ok;
+}
+
+bool FrameRecorder::writeRaw(const unsigned char* rgba)
+{
+    bool ok = true;
+    for (unsigned int y = 0; y < height && ok; ++y)
+    {
+        const unsigned char* source = rgba + (std::size_t)(height - 1 - y) * width * 4;
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            scratch[x * 3] = source[x * 4];
+            scratch[x * 3 + 1] = source[x * 4 + 1];
+            scratch[x * 3 + 2] = source[x * 4 + 2];
+        }
+        ok = std::fwrite(&scratch[0], 1, scratch.size(), file) == scratch.size();
+    }
+    return ok;
+}
+
+// RGB rows without a filter in stored deflate blocks: no zlib needed, the disk takes the size
+bool FrameRecorder::writePNG(const unsigned char* rgba, unsigned int frame)
+{
+    const std::size_t row = 1 + (std::size_t)width * 3;
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const unsigned char* source = rgba + (std::size_t)(height - 1 - y) * width * 4;
+        unsigned char* target = &scratch[y * row];
+        target[0] = 0;
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            target[1 + x * 3] = source[x * 4];
+            target[2 + x * 3] = source[x * 4 + 1];
+            target[3 + x * 3] = source[x * 4 + 2];
+        }
+    }
+
+    char name[512];
+    std::snprintf(name, sizeof(name), path.c_str(), frame);
+    PngFile png;
+    png.file = std::fopen(name, "wb");
+    if (png.file == NULL)
+        return false;
+    png.ok = true;
+    png.write(PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+
+    unsigned char header[13] = { 0 };
+    for (int i = 0; i < 4; ++i)
+    {
+        header[i] = (unsigned char)(width >> (24 - 8 * i));
+        header[4 + i] = (unsigned char)(height >> (24 - 8 * i));
+    }
+    header[8] = 8;                                  // bits per channel
+    header[9] = 2;                                  // RGB
+    png.beginChunk("IHDR", sizeof(header));
+    png.write(header, sizeof(header));
+    png.endChunk();
+
+    // zlib stream: header, stored blocks, Adler-32 of the rows
+    const std::size_t size = scratch.size();
+    const std::size_t blocks = (size + PNG_STORED_BLOCK - 1) / PNG_STORED_BLOCK;
+    png.beginChunk("IDAT", (uint32_t)(2 + blocks * 5 + size + 4));
+    const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+    png.write(zlibHeader, 2);
+    uint32_t a = 1, b = 0;
+    for (std::size_t offset = 0; offset < size; offset += PNG_STORED_BLOCK)
+    {
+        uint32_t length = (uint32_t)std::min<std::size_t>(PNG_STORED_BLOCK, size - offset);
+        unsigned char block[5] = { (unsigned char)(offset + length == size ? 1 : 0),
+            (unsigned char)length, (unsigned char)(length >> 8), (unsigned char)~length, (unsigned char)(~length >> 8) };
+        png.write(block, 5);
+        png.write(&scratch[offset], length);
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            a += scratch[offset + i];
+            b += a;
+            if ((i & 4095) == 4095)
+            {
+                a %= 65521;
+                b %= 65521;
+            }
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    png.writeUint((b << 16) | a);
+    png.endChunk();
+
+    png.beginChunk("IEND", 0);
+    png.endChunk();
+    return std::fclose(png.file) == 0 && png.ok;
+}
@@ -1,9 +1,18 @@
 #include <header/solar.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
 // Constants
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// framebuffer the render loops draw to, the window's size or any size offscreen
+unsigned int viewportWidth = SCR_WIDTH;
+unsigned int viewportHeight = SCR_HEIGHT;
+
 // Camera variables
 Camera camera;
 float lastX = SCR_WIDTH / 2.0f;
@@ -14,8 +23,37 @@ bool firstMouse = true;
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f;
 
+// Simulation time, advanced in fixed ticks so checkpoints replay exactly
+SimulationClock simulationClock;
+CheckpointWriter checkpointWriter;
+bool checkpointKeysDown = false;
+bool traceKeyDown = false;
+bool overlayKeyDown = false;
+bool recordKeyDown = false;
+unsigned int recordPart = 0;        // part of the window recording, a new one starts at each resize
+
 // OpenGL buffers
-unsigned int VBO, VAO, EBO;
+unsigned int impostorVAO = 0, impostorVBO = 0;
+
+// per-frame culling of the bodies and what was drawn
+FrustumCuller bodyCuller;
+OcclusionCuller bodyOcclusion;
+std::vector<int> visibleBodies;
+std::vector<glm::vec3> bodyCenters;     // relative to the camera
+std::vector<float> bodyDistances;
+RenderStats renderStats = {};
+
+// frame time graph and counters in the corner, F3 shows and hides it
+PerformanceOverlay performanceOverlay;
+
+// bodies smaller than this radius on screen are ray-cast on a quad instead of rasterized
+const float IMPOSTOR_MAX_PIXELS = 16.0f;
+
+// Keplerian orbit paths are sampled again when the day crosses into another decade,
+// their elements drift too slowly to show any sooner
+const double ORBIT_EPOCH_DAYS = 3652.5;
+const float ORBIT_LINE_WIDTH = 1.5f;
+const glm::vec4 ORBIT_COLOR(0.45f, 0.55f, 0.8f, 0.6f);
 
 // Planet properties
 const float SUN_ROTATION_AXIS = 7.25;
@@ -39,6 +77,12 @@ const float SATURN_RADIUS = 0.000129;
 const float URANUS_RADIUS = 0.000056;
 const float NEPTUNE_RADIUS = 0.000055;
 
+// ring edges, from the inner D ring to the outer A ring, and around the epsilon ring
+const float SATURN_RING_INNER_RADIUS = SATURN_RADIUS * 1.11f;
+const float SATURN_RING_OUTER_RADIUS = SATURN_RADIUS * 2.27f;
+const float URANUS_RING_INNER_RADIUS = URANUS_RADIUS * 1.64f;
+const float URANUS_RING_OUTER_RADIUS = URANUS_RADIUS * 2.0f;
+
 const float MERCURY_DISTANCE_FROM_SUN = 0.129;
 const float VENUS_DISTANCE_FROM_SUN = 0.240;
 const float EARTH_DISTANCE_FROM_SUN = 0.333;
@@ -68,10 +112,12 @@ const float SATURN_ORBITAL_PERIOD_YEAR = 29.46;
 const float URANUS_ORBITAL_PERIOD_YEAR = 84.01;
 const float NEPTUNE_ORBITAL_PERIOD_YEAR = 164.8;
 
+#ifndef SOLAR_NO_WINDOW
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
 {
+    ProfileScope scope(PROFILE_INPUT);
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
@@ -87,8 +133,80 @@ void processInput(GLFWwindow* window)
         camera.ProcessKeyboard(UP, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
         camera.ProcessKeyboard(DOWN, deltaTime);
+
+    // F5 saves and F9 loads a checkpoint, once per key press
+    bool saveDown = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+    bool loadDown = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if (!checkpointKeysDown && saveDown)
+        saveCheckpoint(CHECKPOINT_FILE);
+    if (!checkpointKeysDown && loadDown)
+        loadCheckpoint(CHECKPOINT_FILE);
+    checkpointKeysDown = saveDown || loadDown;
+
+    // F12 writes the profiler's trace of the last frames
+    bool traceDown = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+    if (!traceKeyDown && traceDown)
+        profiler.writeTrace(PROFILER_TRACE_FILE);
+    traceKeyDown = traceDown;
+
+    bool overlayDown = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (!overlayKeyDown && overlayDown)
+        performanceOverlay.setVisible(!performanceOverlay.isVisible());
+    overlayKeyDown = overlayDown;
+
+    // F8 starts and stops recording the window, frames are dropped rather than slowing it down
+    bool recordDown = glfwGetKey(window, GLFW_KEY_F8) == GLFW_PRESS;
+    if (!recordKeyDown && recordDown)
+    {
+        if (frameRecorder.isRecording())
+        {
+            frameRecorder.stop();
+        }
+        else
+        {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            recordPart = 1;
+            frameRecorder.start(RECORDER_WINDOW_FILE, width, height, RECORDER_WINDOW_FPS, true);
+        }
+    }
+    recordKeyDown = recordDown;
+}
+#endif
+
+// queue the clock and camera for writing, the render loop does not wait for the disk
+// ----------------------------------------------------------------------
+void saveCheckpoint(const char* path)
+{
+    CheckpointData data;
+    std::memset(&data, 0, sizeof(data));
+    data.clock = simulationClock.getState();
+    data.camera.position[0] = camera.Position.x;
+    data.camera.position[1] = camera.Position.y;
+    data.camera.position[2] = camera.Position.z;
+    data.camera.yaw = camera.Yaw;
+    data.camera.pitch = camera.Pitch;
+    data.camera.zoom = camera.Zoom;
+    checkpointWriter.submit(path, data);
+    std::cout << "Checkpoint saved at tick " << simulationClock.getTick() << std::endl;
 }
 
+void loadCheckpoint(const char* path)
+{
+    // a save still in flight must land before it can be read back
+    checkpointWriter.flush();
+
+    CheckpointData data;
+    if (!readCheckpoint(path, data))
+        return;
+    simulationClock.setState(data.clock);
+    camera = Camera(glm::dvec3(data.camera.position[0], data.camera.position[1], data.camera.position[2]),
+        glm::vec3(0.0f, 1.0f, 0.0f), data.camera.yaw, data.camera.pitch);
+    camera.Zoom = data.camera.zoom;
+    std::cout << "Checkpoint loaded at tick " << simulationClock.getTick() << std::endl;
+}
+
+#ifndef SOLAR_NO_WINDOW
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -96,6 +214,21 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+
+    // the projection, lines and overlay follow; a minimized window keeps its last size
+    if (width <= 0 || height <= 0 || ((unsigned int)width == viewportWidth && (unsigned int)height == viewportHeight))
+        return;
+    viewportWidth = width;
+    viewportHeight = height;
+
+    // every frame of a video has the same size, the recording goes on in a new part
+    if (frameRecorder.isRecording())
+    {
+        frameRecorder.stop();
+        char path[64];
+        std::snprintf(path, sizeof(path), RECORDER_WINDOW_PART_FILE, ++recordPart);
+        frameRecorder.start(path, width, height, RECORDER_WINDOW_FPS, true);
+    }
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -127,54 +260,431 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
+#endif
 
-// draw each sphere using its own texture and coordinates
+// draw each sphere using its own texture and coordinates, the mesh is uploaded on first use
+// wireframe draws the sphere's grid lines instead, with a line shader (wire.vs, line.fs, line.gs)
 // ----------------------------------------------------------------------
-void drawSphere(Sphere sphere, Shader shaderProgram, bool wireframe)
+void drawSphere(Sphere& sphere, const Shader& shaderProgram, bool wireframe)
 {
+    if (sphere.getVertexArray() == 0)
+    {
+        unsigned int sphereVAO, sphereVBO, sphereEBO;
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereVBO);
+        glGenBuffers(1, &sphereEBO);
+        glState.bindVertexArray(sphereVAO);
+
+        // set VBO from vetices generated from Sphere
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glState.bufferData(sphereVBO, GL_ARRAY_BUFFER, sphere.getInterleavedVertexSize(), sphere.getInterleavedVertices(), GL_STATIC_DRAW);
+
+        // set EBO from indices generated from Sphere, followed by its line indices for the wireframe
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+        glState.bufferData(sphereEBO, GL_ELEMENT_ARRAY_BUFFER, sphere.getIndexSize() + sphere.getLineIndexSize(), NULL, GL_STATIC_DRAW);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sphere.getIndexSize(), sphere.getIndices());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sphere.getIndexSize(), sphere.getLineIndexSize(), sphere.getLineIndices());
+
+        // set stride from sphere
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        sphere.setBuffers(sphereVAO, sphereVBO, sphereEBO);
+    }
+
     shaderProgram.use();
-    glActiveTexture(sphere.getTextureGL());
-    glBindTexture(GL_TEXTURE_2D, sphere.getTexture());
+    glState.bindTexture(sphere.getTextureGL(), GL_TEXTURE_2D, sphere.getTexture());
     shaderProgram.setInt("material.diffuse", sphere.getTextureInt());
     shaderProgram.setInt("material.specular", sphere.getTextureInt());
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    // draw
+    glState.bindVertexArray(sphere.getVertexArray());
+    if (wireframe)
+    {
+        glDrawElements(GL_LINES, sphere.getLineIndexCount(), GL_UNSIGNED_INT, (void*)(std::size_t)sphere.getIndexSize());
+        glState.countDraw(GL_LINES, sphere.getLineIndexCount());
+    }
+    else
+    {
+        glDrawElements(GL_TRIANGLES, sphere.getIndexCount(), GL_UNSIGNED_INT, 0);
+        glState.countDraw(GL_TRIANGLES, sphere.getIndexCount());
+    }
+}
 
-    glBindVertexArray(VAO);
+void deleteSphere(Sphere& sphere)
+{
+    unsigned int sphereVBO = sphere.getVertexBuffer(), sphereEBO = sphere.getIndexBuffer();
+    glState.deleteVertexArray(sphere.getVertexArray());
+    glState.deleteBuffer(sphereVBO);
+    glState.deleteBuffer(sphereEBO);
+    sphere.setBuffers(0, 0, 0);
+}
 
-    // set VBO from vetices generated from Sphere
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sphere.getInterleavedVertexSize(), sphere.getInterleavedVertices(), GL_STATIC_DRAW);
+// draw a body as a camera-facing quad, the fragment shader ray-casts the sphere
+// ----------------------------------------------------------------------
+void drawImpostor(const Sphere& sphere, const Shader& shaderProgram, const glm::mat4& model)
+{
+    if (impostorVAO == 0)
+    {
+        const float corners[] = { -1.0f, -1.0f,   1.0f, -1.0f,   -1.0f, 1.0f,   1.0f, 1.0f };
+        glGenVertexArrays(1, &impostorVAO);
+        glGenBuffers(1, &impostorVBO);
+        glState.bindVertexArray(impostorVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, impostorVBO);
+        glState.bufferData(impostorVBO, GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 
-    // set EBO from indices generated from Sphere
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.getIndexSize(), sphere.getIndices(), GL_STATIC_DRAW);
+    shaderProgram.use();
+    glState.bindTexture(sphere.getTextureGL(), GL_TEXTURE_2D, sphere.getTexture());
+    shaderProgram.setInt("material.diffuse", sphere.getTextureInt());
+    shaderProgram.setInt("material.specular", sphere.getTextureInt());
+    shaderProgram.setVec3("center", glm::vec3(model[3]));
+    shaderProgram.setFloat("radius", sphere.getRadius());
+    shaderProgram.setMat3("orientation", glm::mat3(model));
 
-    // set stride from sphere
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    glState.bindVertexArray(impostorVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glState.countDraw(GL_TRIANGLE_STRIP, 4);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+// the quad is created again in the next context, a benchmark runs each path in a new one
+void deleteImpostor()
+{
+    glState.deleteVertexArray(impostorVAO);
+    glState.deleteBuffer(impostorVBO);
+    impostorVAO = 0;
+    impostorVBO = 0;
+}
 
-    glBindVertexArray(0);
+// radius in pixels of a sphere seen by the camera, for choosing between mesh and impostor, center relative to the camera
+// ----------------------------------------------------------------------
+float screenRadius(float radius, const glm::vec3& center)
+{
+    float distance = glm::length(center);
+    if (distance <= radius)
+        return (float)viewportHeight;
+    return radius / (distance * std::tan(glm::radians(camera.Zoom) * 0.5f)) * (viewportHeight * 0.5f);
+}
 
-    // draw
-    if (wireframe) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+// cull the bodies against the view frustum, then draw the visible ones front to back so near bodies
+// hide far ones from the occlusion queries, distant ones as impostors
+// everything is camera-relative: the double world positions minus the camera position, then floats
+// ----------------------------------------------------------------------
+void drawBodies(const CelestialBody* bodies, int count, const BodyTransformBatch& batch, const Shader& impostorShader,
+    const Shader& emissiveImpostorShader, const glm::mat4& projection, const glm::mat4& view)
+{
+    int culling = profiler.begin(PROFILE_CULLING);
+    bodyCenters.resize(count);
+    for (int i = 0; i < count; ++i)
+        bodyCenters[i] = camera.RelativePosition(batch.getPosition(bodies[i].transform));
+
+    bodyCuller.resize(count);
+    for (int i = 0; i < count; ++i)
+        bodyCuller.setSphere(i, bodyCenters[i], boundingRadius(bodies[i]));
+    unsigned int visibleCount = bodyCuller.cull(projection * view, visibleBodies);
+
+    // bodies out of view start over as visible when they come back
+    bodyOcclusion.resize(count);
+    bodyOcclusion.beginFrame(projection, view, glm::vec3(0.0f));
+    for (int i = 0, v = 0; i < count; ++i)
+    {
+        if (v < (int)visibleCount && visibleBodies[v] == i)
+            ++v;
+        else
+            bodyOcclusion.reset(i);
     }
-    else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    bodyDistances.resize(count);
+    for (int i = 0; i < count; ++i)
+        bodyDistances[i] = glm::length(bodyCenters[i]);
+    std::sort(visibleBodies.begin(), visibleBodies.end(), [](int a, int b) { return bodyDistances[a] < bodyDistances[b]; });
+    profiler.end(culling);
+
+    ProfileScope scope(PROFILE_BODIES);
+
+    for (unsigned int v = 0; v < visibleCount; ++v)
+    {
+        int index = visibleBodies[v];
+        const CelestialBody& body = bodies[index];
+        glm::vec3 center = bodyCenters[index];
+        glm::mat4 model = batch.getModel(body.transform);
+        model[3] = glm::vec4(center, 1.0f);
+
+        bodyOcclusion.beginBody(index, center, boundingRadius(body));
+        if (screenRadius(body.sphere->getRadius(), center) < IMPOSTOR_MAX_PIXELS)
+        {
+            // the sun has no parent and is unlit
+            drawImpostor(*body.sphere, body.parent < 0 ? emissiveImpostorShader : impostorShader, model);
+        }
+        else
+        {
+            body.shader->use();
+            body.shader->setMat4("model", model);
+            if (body.ring)
+            {
+                // the ring's shadow on the planet, looked up from the ring texture by the ringed variant
+                glState.bindTexture(body.ring->getTextureGL(), GL_TEXTURE_2D, body.ring->getTexture());
+                body.shader->setInt("ringTexture", body.ring->getTextureInt());
+                body.shader->setVec2("ringRadii", body.ring->getInnerRadius(), body.ring->getOuterRadius());
+                body.shader->setVec3("ringCenter", center);
+                body.shader->setVec3("ringNormal", glm::normalize(glm::vec3(model[2])));
+            }
+            drawSphere(*body.sphere, *body.shader, false);
+        }
+        bodyOcclusion.endBody(index);
     }
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, sphere.getIndexCount(), GL_UNSIGNED_INT, 0);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderStats.visible = visibleCount;
+    renderStats.culled = count - visibleCount;
+    renderStats.queries = bodyOcclusion.getIssued();
+    renderStats.occluded = bodyOcclusion.getOccluded();
+}
+
+// radius of the sphere around a body and its rings, for culling
+// ----------------------------------------------------------------------
+float boundingRadius(const CelestialBody& body)
+{
+    if (body.ring)
+        return std::max(body.sphere->getRadius(), body.ring->getOuterRadius());
+    return body.sphere->getRadius();
+}
+
+// draw a ring around its planet, blended over what is already drawn, the mesh is uploaded on first use
+// ----------------------------------------------------------------------
+void drawRing(Annulus& ring, const Shader& shaderProgram, const glm::mat4& model, float planetRadius)
+{
+    if (ring.getVertexArray() == 0)
+    {
+        unsigned int ringVAO, ringVBO, ringEBO;
+        glGenVertexArrays(1, &ringVAO);
+        glGenBuffers(1, &ringVBO);
+        glGenBuffers(1, &ringEBO);
+        glState.bindVertexArray(ringVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
+        glState.bufferData(ringVBO, GL_ARRAY_BUFFER, ring.getInterleavedVertexSize(), ring.getInterleavedVertices(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ringEBO);
+        glState.bufferData(ringEBO, GL_ELEMENT_ARRAY_BUFFER, ring.getIndexSize(), ring.getIndices(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, ring.getInterleavedStride(), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, ring.getInterleavedStride(), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, ring.getInterleavedStride(), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        ring.setBuffers(ringVAO, ringVBO, ringEBO);
+    }
+
+    shaderProgram.use();
+    glState.bindTexture(ring.getTextureGL(), GL_TEXTURE_2D, ring.getTexture());
+    shaderProgram.setInt("ringTexture", ring.getTextureInt());
+    shaderProgram.setVec2("ringRadii", ring.getInnerRadius(), ring.getOuterRadius());
+    shaderProgram.setMat4("model", model);
+    shaderProgram.setVec3("planetCenter", glm::vec3(model[3]));
+    shaderProgram.setFloat("planetRadius", planetRadius);
+
+    glState.bindVertexArray(ring.getVertexArray());
+    glDrawElements(GL_TRIANGLES, ring.getIndexCount(), GL_UNSIGNED_INT, 0);
+    glState.countDraw(GL_TRIANGLES, ring.getIndexCount());
+}
+
+// transparent pass after every opaque draw: the rings of this frame's visible bodies, far to near,
+// without depth writes so the planet shows through the gaps on both sides of the ring
+// ----------------------------------------------------------------------
+void drawRings(const CelestialBody* bodies, const BodyTransformBatch& batch, const Shader& ringShader)
+{
+    ProfileScope scope(PROFILE_RINGS);
+    glState.enable(GL_BLEND);
+    glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.depthMask(false);
+
+    // visibleBodies is still sorted near to far by drawBodies
+    for (int v = renderStats.visible - 1; v >= 0; --v)
+    {
+        int index = visibleBodies[v];
+        const CelestialBody& body = bodies[index];
+        if (!body.ring)
+            continue;
+
+        glm::mat4 model = batch.getModel(body.transform);
+        model[3] = glm::vec4(bodyCenters[index], 1.0f);
+
+        bodyOcclusion.resumeBody(index);
+        drawRing(*body.ring, ringShader, model, body.sphere->getRadius());
+        bodyOcclusion.endBody(index);
+    }
+
+    glState.depthMask(true);
+    glState.disable(GL_BLEND);
+}
+
+void deleteRing(Annulus& ring)
+{
+    unsigned int ringVBO = ring.getVertexBuffer(), ringEBO = ring.getIndexBuffer();
+    glState.deleteVertexArray(ring.getVertexArray());
+    glState.deleteBuffer(ringVBO);
+    glState.deleteBuffer(ringEBO);
+    ring.setBuffers(0, 0, 0);
+}
+
+#ifndef SOLAR_NO_WINDOW
+// show this frame's render statistics in the window title, twice a second
+// ----------------------------------------------------------------------
+void showRenderStats(GLFWwindow* window)
+{
+    static double lastUpdate = 0.0;
+    double now = glfwGetTime();
+    if (now - lastUpdate < 0.5)
+        return;
+    lastUpdate = now;
+
+    const GLStateCounters& state = glState.getLastFrameCounters();
+    char title[160];
+    std::snprintf(title, sizeof(title), "Solar_System | bodies visible %u, culled %u, occluded %u | queries %u | state changes %u, skipped %u",
+        renderStats.visible, renderStats.culled, renderStats.occluded, renderStats.queries, state.issued, state.skipped);
+    glfwSetWindowTitle(window, title);
+}
+#endif
+
+// camera uniforms of a shader, the eye is at the origin and the sun, at the world origin, moves with the camera
+// ----------------------------------------------------------------------
+void setCameraUniforms(const Shader& shaderProgram, const glm::mat4& projection, const glm::mat4& view)
+{
+    shaderProgram.use();
+    shaderProgram.setMat4("projection", projection);
+    shaderProgram.setMat4("view", view);
+    shaderProgram.setVec3("viewPos", 0.0f, 0.0f, 0.0f);
+    shaderProgram.setVec3("pointLights.position", camera.RelativePosition(glm::dvec3(0.0)));
+}
+
+// material and sun light of the lit shaders
+// ----------------------------------------------------------------------
+void setPlanetLighting(const Shader& shaderProgram)
+{
+    shaderProgram.use();
+
+    // shininess for specular light
+    shaderProgram.setFloat("material.shininess", 32.0f);
+
+    // pointlight properties
+    shaderProgram.setVec3("pointLights.position", 0.0f, 0.0f, 0.0f);
+    shaderProgram.setVec3("pointLights.ambient", 0.2f, 0.2f, 0.2f);
+    shaderProgram.setVec3("pointLights.diffuse", 0.5f, 0.5f, 0.5f);
+    shaderProgram.setVec3("pointLights.specular", 1.0f, 1.0f, 1.0f);
+    shaderProgram.setFloat("pointLights.constant", 1.0f);
+    shaderProgram.setFloat("pointLights.linear", 0.09f);
+    shaderProgram.setFloat("pointLights.quadratic", 0.032f);
+    shaderProgram.setFloat("pointLights.linear", 0.0014f);
+    shaderProgram.setFloat("pointLights.quadratic", 0.000007f);
+}
+
+// add an orbit node and a transform per body, parents must come before their moons
+// bodies around a fixed parent (the sun) are roots, so their model matrices need no parent multiply
+// ----------------------------------------------------------------------
+void addBodies(TransformGraph& transforms, BodyTransformBatch& batch, CelestialBody* bodies, int count)
+{
+    transforms.reserve(transforms.getNodeCount() + count);
+    batch.reserve(batch.getCount() + count);
+    for (int i = 0; i < count; ++i)
+    {
+        int parent = bodies[i].parent;
+        bool movingParent = parent >= 0 && parent < i && bodies[parent].orbitalPeriod != 0.0f;
+        bodies[i].orbitNode = transforms.addNode(movingParent ? bodies[parent].orbitNode : -1);
+        bodies[i].transform = batch.add(bodies[i].rotationAxis);
+    }
+}
+
+// compose this frame's model matrices with the closed-form kernel, then attach moons to their parent frames
+// ----------------------------------------------------------------------
+void updateBodies(TransformGraph& transforms, BodyTransformBatch& batch, CelestialBody* bodies, int count, const Ephemeris& ephemeris, double day, float time)
+{
+    ProfileScope scope(PROFILE_MATRICES);
+    const double TWO_PI = 6.283185307179586;
+    for (int i = 0; i < count; ++i)
+    {
+        const CelestialBody& body = bodies[i];
+        float spinAngle = (float)std::fmod((double)time / body.rotationPeriod, TWO_PI);
+        if (body.orbitalPeriod == 0.0f)
+        {
+            batch.set(body.transform, 0.0f, 0.0f, spinAngle);
+        }
+        else if (ephemeris.isOpen() && body.ephemerisBody >= 0)
+        {
+            // ecliptic (x, y, z) in AU to scene (x, z, -y), 1 AU = EARTH_DISTANCE_FROM_SUN
+            glm::dvec3 position = ephemeris.position(body.ephemerisBody, day) * (double)(body.distanceScale * EARTH_DISTANCE_FROM_SUN);
+            batch.set(body.transform, 0.0, 0.0, spinAngle);
+            batch.setOffset(body.transform, glm::dvec3(position.x, position.z, -position.y));
+        }
+        else
+        {
+            double orbitAngle = std::fmod((double)time / body.orbitalPeriod, TWO_PI);
+            batch.set(body.transform, orbitAngle, (double)body.distanceScale * body.distance, spinAngle);
+        }
+    }
+    batch.compose();
+    batch.composePositions();
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (bodies[i].orbitalPeriod != 0.0f)
+            transforms.setLocal(bodies[i].orbitNode, batch.getOrbit(bodies[i].transform));
+    }
+    transforms.update();
+
+    for (int i = 0; i < count; ++i)
+    {
+        int parentNode = transforms.getParent(bodies[i].orbitNode);
+        if (parentNode >= 0)
+        {
+            // the parent frame's origin is the parent's position, which is already a world position
+            const glm::mat4& parentWorld = transforms.getWorld(parentNode);
+            glm::dvec3& position = batch.getPosition(bodies[i].transform);
+            position = batch.getPosition(bodies[bodies[i].parent].transform) + glm::dmat3(glm::mat3(parentWorld)) * position;
+            batch.getModel(bodies[i].transform) = parentWorld * batch.getModel(bodies[i].transform);
+        }
+    }
+}
+
+// orbit path of every body around its parent, the same orbits updateBodies moves the bodies on
+// ----------------------------------------------------------------------
+void updateOrbitPaths(OrbitPaths& orbits, const CelestialBody* bodies, int count, const BodyTransformBatch& batch, const Ephemeris& ephemeris, double day, float time)
+{
+    ProfileScope scope(PROFILE_SIMULATION);
+    const double TWO_PI = 6.283185307179586;
+    for (int i = 0; i < count; ++i)
+    {
+        const CelestialBody& body = bodies[i];
+        if (body.orbitalPeriod == 0.0f || body.parent < 0)
+        {
+            orbits.setPlacement(i, glm::vec3(0.0f), 0.0f, glm::vec4(0.0f));
+            continue;
+        }
+
+        double phase;
+        if (ephemeris.isOpen() && body.ephemerisBody >= 0)
+        {
+            double epoch = std::floor(day / ORBIT_EPOCH_DAYS) * ORBIT_EPOCH_DAYS;
+            double periodDays = body.orbitalPeriod * 365.25;
+            orbits.setKepler(i, body.ephemerisBody, epoch, periodDays, body.distanceScale * EARTH_DISTANCE_FROM_SUN);
+            phase = (day - epoch) / periodDays;
+        }
+        else
+        {
+            orbits.setCircle(i, body.distanceScale * body.distance);
+            phase = std::fmod((double)time / body.orbitalPeriod, TWO_PI) / TWO_PI;
+        }
+        phase -= std::floor(phase);
+
+        glm::vec3 parentCenter = camera.RelativePosition(batch.getPosition(bodies[body.parent].transform));
+        orbits.setPlacement(i, parentCenter, (float)phase, ORBIT_COLOR);
+    }
 }
 
 // load texture and handle error
@@ -196,9 +706,10 @@ unsigned int loadTexture(char const* path)
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        glState.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        glState.textureStorage(textureID, (std::size_t)width * height * (nrComponents == 1 ? 1 : 4) * 4 / 3);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -0,0 +1,585 @@
+#include <header/Benchmark.h>
+#include <header/RenderBackend.h>
+#include <header/solar.h>
+
+#ifdef SOLAR_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// builds without GLFW have no window and need EGL for the offscreen context
+#if defined(SOLAR_NO_WINDOW) && !defined(SOLAR_EGL)
+#error SOLAR_NO_WINDOW needs SOLAR_EGL
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int HEADLESS_DEFAULT_FRAMES = 300;
+const double HEADLESS_DEFAULT_FRAME_TIME = 1.0 / 60.0;
+#ifdef SOLAR_EGL
+const EGLint BACKEND_EGL_CONTEXT_ATTRIBUTES[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+#endif
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+BackendOptions::BackendOptions() : type(BACKEND_WINDOW), frames(HEADLESS_DEFAULT_FRAMES),
+    frameTime(HEADLESS_DEFAULT_FRAME_TIME), capturePath(NULL), cameraPath(NULL), log(NULL), tracePath(NULL), overlay(true),
+    recordPath(NULL), width(0), height(0)
+{
+}
+
+RenderBackend::RenderBackend() : width(0), height(0), window(NULL), display(NULL), config(NULL), context(NULL),
+    loaderContext(NULL), framebuffer(0), colorBuffer(0), depthBuffer(0), frame(0)
+{
+    timeQueries[0] = timeQueries[1] = 0;
+}
+
+RenderBackend::~RenderBackend()
+{
+    destroy();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// context creation
+///////////////////////////////////////////////////////////////////////////////
+bool RenderBackend::create(const BackendOptions& options, unsigned int width, unsigned int height, const char* title)
+{
+    destroy();
+    this->options = options;
+    this->width = options.width ? options.width : width;
+    this->height = options.height ? options.height : height;
+    viewportWidth = this->width;
+    viewportHeight = this->height;
+    frame = 0;
+    frameStats.clear();
+    heapTracker.reset();
+
+    if (options.type == BACKEND_WINDOW)
+        return createWindow(true, title);
+
+    frameStats.reserve(options.frames);
+    if (!createDisplayless(title) || !createFramebuffer())
+    {
+        destroy();
+        return false;
+    }
+    glGenQueries(2, timeQueries);
+    if (options.recordPath && !frameRecorder.start(options.recordPath, this->width, this->height, 1.0 / options.frameTime, false))
+    {
+        destroy();
+        return false;
+    }
+    if (options.log)
+    {
+        options.log->renderer = (const char*)glGetString(GL_RENDERER);
+        options.log->frames.clear();
+    }
+    return true;
+}
+
+bool RenderBackend::createWindow(bool visible, const char* title)
+{
+#ifdef SOLAR_NO_WINDOW
+    (void)visible;
+    (void)title;
+    std::cout << "ERROR::BACKEND::NO_WINDOW: built without GLFW, only the offscreen backend is available" << std::endl;
+    return false;
+#else
+    // glfw: initialize and configure
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // glfw window creation
+    // --------------------
+    window = glfwCreateWindow(width, height, title, NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (visible)
+    {
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    glTrace.install();
+
+    // on HiDPI displays the framebuffer has more pixels than the window asked for
+    if (visible)
+    {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        framebuffer_size_callback(window, framebufferWidth, framebufferHeight);
+    }
+    return true;
+#endif
+}
+
+// EGL without any surface: Mesa's surfaceless platform needs neither X nor a GPU,
+// other drivers get the default display and render to the framebuffer object all the same
+bool RenderBackend::createDisplayless(const char* title)
+{
+#ifdef SOLAR_EGL
+    (void)title;    // nothing shows a title without a surface
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        std::cout << "ERROR::BACKEND::EGL_NOT_INITIALIZED: " << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig eglConfig;
+    EGLint configCount = 0;
+    eglChooseConfig(eglDisplay, configAttributes, &eglConfig, 1, &configCount);
+    config = configCount > 0 ? eglConfig : EGL_NO_CONFIG_KHR;
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext eglContext = eglCreateContext(eglDisplay, (EGLConfig)config, EGL_NO_CONTEXT, BACKEND_EGL_CONTEXT_ATTRIBUTES);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::BACKEND::EGL_CONTEXT_NOT_CREATED: " << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    context = eglContext;
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        std::cout << "ERROR::BACKEND::EGL_CONTEXT_NOT_CURRENT: " << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    glTrace.install();
+    std::cout << "Offscreen: EGL " << major << "." << minor << ", " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+    return true;
+#else
+    // without EGL a hidden window provides the context, the frames still go to the framebuffer object
+    if (!createWindow(false, title))
+        return false;
+    std::cout << "Offscreen: hidden window, " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+    return true;
+#endif
+}
+
+// the loader context needs no surface either, a window only where GLFW makes the contexts
+bool RenderBackend::createLoaderContext()
+{
+    if (loaderContext)
+        return true;
+#ifdef SOLAR_EGL
+    if (display)
+    {
+        EGLContext eglContext = eglCreateContext((EGLDisplay)display, (EGLConfig)config, (EGLContext)context, BACKEND_EGL_CONTEXT_ATTRIBUTES);
+        if (eglContext == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR::BACKEND::LOADER_CONTEXT_NOT_CREATED: " << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+        loaderContext = eglContext;
+        return true;
+    }
+#endif
+#ifndef SOLAR_NO_WINDOW
+    if (window)
+    {
+        // the hints of the render context are still set
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        loaderContext = glfwCreateWindow(1, 1, "", NULL, window);
+        if (loaderContext == NULL)
+        {
+            std::cout << "ERROR::BACKEND::LOADER_CONTEXT_NOT_CREATED" << std::endl;
+            return false;
+        }
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool RenderBackend::makeLoaderContextCurrent()
+{
+#ifdef SOLAR_EGL
+    if (display && loaderContext)
+    {
+        // the bound API is per thread
+        eglBindAPI(EGL_OPENGL_API);
+        return eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)loaderContext) == EGL_TRUE;
+    }
+#endif
+#ifndef SOLAR_NO_WINDOW
+    if (window && loaderContext)
+    {
+        glfwMakeContextCurrent((GLFWwindow*)loaderContext);
+        return true;
+    }
+#endif
+    return false;
+}
+
+void RenderBackend::releaseLoaderContext()
+{
+#ifdef SOLAR_EGL
+    if (display)
+    {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglReleaseThread();
+        return;
+    }
+#endif
+#ifndef SOLAR_NO_WINDOW
+    if (window)
+        glfwMakeContextCurrent(NULL);
+#endif
+}
+
+bool RenderBackend::createFramebuffer()
+{
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::BACKEND::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return false;
+    }
+
+    // stays bound: everything the render loop draws lands here
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void RenderBackend::destroy()
+{
+    // the recording's last frames are still on the GPU
+    if (frameRecorder.isRecording())
+        frameRecorder.stop();
+
+    // binaries of the programs compiled by this run, for the next launch
+    shaderCache.save();
+
+    // the profiler's queries go before the context
+    if (options.tracePath && (display || window))
+        profiler.writeTrace(options.tracePath);
+    profiler.destroy();
+
+    if (timeQueries[0])
+    {
+        glDeleteQueries(2, timeQueries);
+        timeQueries[0] = timeQueries[1] = 0;
+    }
+
+    if (framebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        framebuffer = colorBuffer = depthBuffer = 0;
+    }
+
+#ifdef SOLAR_EGL
+    if (display)
+    {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (loaderContext)
+            eglDestroyContext((EGLDisplay)display, (EGLContext)loaderContext);
+        if (context)
+            eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        eglTerminate((EGLDisplay)display);
+    }
+#endif
+    display = config = context = NULL;
+
+#ifndef SOLAR_NO_WINDOW
+    if (window)
+    {
+        if (loaderContext)
+            glfwDestroyWindow((GLFWwindow*)loaderContext);
+        // glfw: terminate, clearing all previously allocated GLFW resources.
+        glfwTerminate();
+        window = NULL;
+    }
+#endif
+    loaderContext = NULL;
+
+    // a later context starts with GL defaults
+    glState.invalidate();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// frames
+///////////////////////////////////////////////////////////////////////////////
+bool RenderBackend::beginFrame()
+{
+    if (options.type == BACKEND_WINDOW)
+    {
+#ifndef SOLAR_NO_WINDOW
+        if (glfwWindowShouldClose(window))
+            return false;
+#endif
+    }
+    else
+    {
+        if (frame >= options.frames)
+            return false;
+        if (options.cameraPath)
+            options.cameraPath->apply(getTime(), camera);
+        frameStart = std::chrono::steady_clock::now();
+        glQueryCounter(timeQueries[0], GL_TIMESTAMP);
+    }
+    profiler.beginFrame();
+    glTrace.beginFrame();
+    heapTracker.beginFrame();
+    return true;
+}
+
+void RenderBackend::endFrame()
+{
+    if (frameRecorder.isRecording())
+    {
+        ProfileScope scope(PROFILE_CAPTURE);
+        frameRecorder.capture();
+    }
+
+    int swap = profiler.begin(PROFILE_SWAP);
+    if (options.type == BACKEND_WINDOW)
+    {
+#ifndef SOLAR_NO_WINDOW
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+#endif
+        ++frame;
+    }
+    else
+    {
+        finishFrame();
+    }
+    profiler.end(swap);
+    profiler.endFrame();
+    glTrace.endFrame();
+    heapTracker.endFrame();
+
+    // the capture is not part of the frame, its pixels are allocated this once
+    if (options.type == BACKEND_OFFSCREEN && frame == options.frames && options.capturePath)
+        writeFrame(options.capturePath);
+}
+
+void RenderBackend::finishFrame()
+{
+    // CPU time up to the last call, then the frame is timed until the GPU is done with it
+    FrameStats stats;
+    stats.cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    glQueryCounter(timeQueries[1], GL_TIMESTAMP);
+    glFinish();
+    stats.frameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+    // both results are available once the frame finished
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(timeQueries[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(timeQueries[1], GL_QUERY_RESULT, &end);
+    stats.gpuMs = end > start ? (float)((end - start) * 1e-6) : 0.0f;
+
+    const GLStateCounters& counters = glState.getFrameCounters();
+    stats.drawCalls = counters.draws;
+    stats.triangles = counters.triangles;
+    stats.stateChanges = counters.issued;
+    frameStats.push_back(stats);
+    if (options.log)
+        options.log->frames.push_back(stats);
+    ++frame;
+}
+
+double RenderBackend::getTime() const
+{
+#ifndef SOLAR_NO_WINDOW
+    if (options.type == BACKEND_WINDOW)
+        return glfwGetTime();
+#endif
+    return frame * options.frameTime;
+}
+
+bool RenderBackend::readFrame(std::vector<unsigned char>& pixels) const
+{
+    if (width == 0 || height == 0)
+        return false;
+
+    const std::size_t row = width * 3;
+    std::vector<unsigned char> flipped(row * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &flipped[0]);
+
+    // GL rows start at the bottom
+    pixels.resize(flipped.size());
+    for (unsigned int y = 0; y < height; ++y)
+        std::memcpy(&pixels[y * row], &flipped[(height - 1 - y) * row], row);
+    return true;
+}
+
+bool RenderBackend::writeFrame(const char* path) const
+{
+    std::vector<unsigned char> pixels;
+    if (!readFrame(pixels))
+        return false;
+
+    FILE* file = std::fopen(path, "wb");
+    bool ok = file != NULL;
+    if (ok)
+    {
+        std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+        ok = std::fwrite(&pixels[0], 1, pixels.size(), file) == pixels.size();
+        ok = std::fclose(file) == 0 && ok;
+    }
+    if (!ok)
+        std::cout << "ERROR::BACKEND::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+    else
+        std::cout << "Frame " << frame << " written to " << path << std::endl;
+    return ok;
+}
+
+// the first frame compiles, uploads and warms the caches, it is reported on its own
+void RenderBackend::printFrameTimes() const
+{
+    if (frameStats.empty())
+        return;
+
+    float first = frameStats[0].frameMs, total = 0.0f, gpuTotal = 0.0f, fastest = 0.0f, slowest = 0.0f;
+    for (std::size_t i = 1; i < frameStats.size(); ++i)
+    {
+        float ms = frameStats[i].frameMs;
+        total += ms;
+        gpuTotal += frameStats[i].gpuMs;
+        fastest = i == 1 ? ms : std::min(fastest, ms);
+        slowest = std::max(slowest, ms);
+    }
+    std::size_t steady = frameStats.size() - 1;
+    char line[224];
+    std::snprintf(line, sizeof(line), "Offscreen: %u frames %ux%u, first %.2f ms, then mean %.3f ms (GPU %.3f ms), min %.3f ms, max %.3f ms",
+        (unsigned int)frameStats.size(), width, height, first, steady ? total / steady : 0.0f, steady ? gpuTotal / steady : 0.0f,
+        fastest, slowest);
+    std::cout << line << std::endl;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// command line
+///////////////////////////////////////////////////////////////////////////////
+int runHeadless(int argc, char** argv)
+{
+    BackendOptions options;
+    options.type = BACKEND_OFFSCREEN;
+    options.overlay = false;
+    bool scaledSize = true;
+    bool backgroundBlack = false;
+    bool heapCheck = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            options.frames = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--frame-time") == 0 && i + 1 < argc)
+            options.frameTime = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            options.capturePath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            options.tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--overlay") == 0)
+            options.overlay = true;
+        else if (std::strcmp(argv[i], "--heap-check") == 0)
+            heapCheck = true;
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            options.recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc && std::sscanf(argv[i + 1], "%ux%u", &options.width, &options.height) == 2
+            && options.width > 0 && options.height > 0)
+            ++i;
+        else if (std::strcmp(argv[i], "--distance") == 0)
+            scaledSize = false;
+        else if (std::strcmp(argv[i], "--black") == 0)
+            backgroundBlack = true;
+        else
+        {
+            std::cout << "usage: --headless [--distance] [--black] [--frames N] [--frame-time seconds] [--capture file.ppm] [--trace file.json] [--overlay] [--heap-check] [--record file] [--size WxH]" << std::endl;
+            return -1;
+        }
+    }
+
+    // same starting points as the interactive versions
+    int result;
+    if (scaledSize)
+    {
+        camera = Camera(glm::dvec3(0.0, 0.0, 80.0));
+        result = solarScaledSize(backgroundBlack, options);
+    }
+    else
+    {
+        camera = Camera(glm::dvec3(0.0, 0.0, 20.0));
+        result = solarScaledDistance(backgroundBlack, options);
+    }
+
+    // test mode: frames after the warm-up must not touch the heap
+    if (result == 0 && heapCheck)
+    {
+        if (heapTracker.getSteadyFramesAllocating() > 0)
+        {
+            std::cout << "ERROR::HEAP::STEADY_FRAMES_ALLOCATED: " << heapTracker.getSteadyFramesAllocating() << " frames" << std::endl;
+            return -1;
+        }
+        std::cout << "Heap check passed" << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,312 @@
+#include <header/ShaderCache.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const char SHADER_CACHE_MAGIC[8] = { 'S', 'O', 'L', 'A', 'R', 'S', 'H', 'D' };
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+// On-disk layout: header, driver string, then one record and its binary per program, native endian
+struct ShaderCacheHeader
+{
+    char magic[8];                      // "SOLARSHD"
+    uint32_t version;
+    uint32_t driverLength;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct ShaderCacheRecord
+{
+    uint64_t key;
+    uint64_t checksum;                  // FNV-1a of the binary
+    uint32_t format;
+    uint32_t size;
+};
+
+ShaderCache shaderCache;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// 64-bit FNV-1a
+///////////////////////////////////////////////////////////////////////////////
+static uint64_t checksum(const unsigned char* bytes, std::size_t size)
+{
+    uint64_t hash = SHADER_CACHE_SEED;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// the terminating zero goes in too, so sources cannot run into each other
+uint64_t ShaderCache::hash(uint64_t key, const char* text)
+{
+    const unsigned char* bytes = (const unsigned char*)text;
+    do
+    {
+        key ^= *bytes;
+        key *= 1099511628211ULL;
+    } while (*bytes++);
+    return key;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+ShaderCache::ShaderCache() : path(SHADER_CACHE_FILE), fileRead(false), changed(false), loaded(0), compiled(0), refused(0),
+    loadMs(0.0), compileMs(0.0), unsupported(false)
+{
+    const char* environment = std::getenv(SHADER_CACHE_ENVIRONMENT);
+    if (environment && *environment)
+        path = environment;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// programs
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderCache::load(unsigned int program, uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open())
+        return false;
+    std::map<uint64_t, ProgramBinary>::iterator it = programs.find(key);
+    if (it == programs.end())
+        return false;
+
+    // the link status waits for the driver, a refused binary leaves the program unlinked
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ProgramBinary& binary = it->second;
+    glProgramBinary(program, binary.format, &binary.data[0], (GLsizei)binary.data.size());
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        ++refused;
+        programs.erase(it);
+        changed = true;
+        return false;
+    }
+    binary.used = true;
+    ++loaded;
+    loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void ShaderCache::prepare(unsigned int program)
+{
+    if (GLAD_GL_ARB_get_program_binary)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCache::store(unsigned int program, uint64_t key, double compileMs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ++compiled;
+    this->compileMs += compileMs;
+    if (!open())
+        return;
+
+    GLint linked = 0, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked)
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    ProgramBinary& binary = programs[key];
+    binary.data.resize(length);
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binary.format, &binary.data[0]);
+    if (written <= 0)
+    {
+        programs.erase(key);
+        return;
+    }
+    binary.data.resize(written);
+    binary.used = true;
+    changed = true;
+}
+
+// the driver's strings decide whether the binaries read from the file can be used at all
+bool ShaderCache::open()
+{
+    GLint formats = 0;
+    if (GLAD_GL_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0)
+    {
+        unsupported = true;
+        return false;
+    }
+
+    if (!fileRead)
+        read();
+    std::string current = std::string((const char*)glGetString(GL_VENDOR)) + "\n" + (const char*)glGetString(GL_RENDERER)
+        + "\n" + (const char*)glGetString(GL_VERSION);
+    if (current != driver)
+    {
+        if (!programs.empty())
+            std::cout << "Shader cache " << path << " is from another driver, compiling from source" << std::endl;
+        programs.clear();
+        driver = current;
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// file
+///////////////////////////////////////////////////////////////////////////////
+void ShaderCache::read()
+{
+    fileRead = true;
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return;
+
+    // the lengths in the file are checked against its size before anything is allocated for them
+    std::fseek(file, 0, SEEK_END);
+    long fileSize = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    uint64_t left = fileSize > 0 ? (uint64_t)fileSize : 0;
+
+    ShaderCacheHeader header;
+    bool ok = left >= sizeof(header) && std::fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.magic, SHADER_CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == SHADER_CACHE_VERSION;
+    if (ok)
+    {
+        left -= sizeof(header);
+        ok = header.driverLength <= left;
+    }
+    if (ok)
+    {
+        driver.resize(header.driverLength);
+        ok = header.driverLength == 0 || std::fread(&driver[0], header.driverLength, 1, file) == 1;
+        left -= header.driverLength;
+    }
+    for (uint32_t i = 0; ok && i < header.count; ++i)
+    {
+        ShaderCacheRecord record;
+        ok = left >= sizeof(record) && std::fread(&record, sizeof(record), 1, file) == 1;
+        if (ok)
+            left -= sizeof(record);
+        ok = ok && record.size > 0 && record.size <= left;
+        if (!ok)
+            break;
+        left -= record.size;
+        ProgramBinary& binary = programs[record.key];
+        binary.format = record.format;
+        binary.used = false;
+        binary.data.resize(record.size);
+        ok = std::fread(&binary.data[0], record.size, 1, file) == 1
+            && checksum(&binary.data[0], record.size) == record.checksum;
+    }
+    std::fclose(file);
+
+    // a damaged file is replaced by the binaries of this run
+    if (!ok)
+    {
+        std::cout << "ERROR::SHADER_CACHE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        programs.clear();
+        driver.clear();
+    }
+}
+
+// write to a temporary file first so a crash never leaves a truncated cache
+void ShaderCache::save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed)
+        return;
+    changed = false;
+
+    // programs of other versions of the sources pile up while shaders are edited
+    if (programs.size() > SHADER_CACHE_MAX_PROGRAMS)
+    {
+        for (std::map<uint64_t, ProgramBinary>::iterator it = programs.begin(); it != programs.end();)
+        {
+            if (it->second.used)
+                ++it;
+            else
+                programs.erase(it++);
+        }
+    }
+
+    ShaderCacheHeader header;
+    std::memcpy(header.magic, SHADER_CACHE_MAGIC, sizeof(header.magic));
+    header.version = SHADER_CACHE_VERSION;
+    header.driverLength = (uint32_t)driver.size();
+    header.count = (uint32_t)programs.size();
+    header.reserved = 0;
+
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    bool ok = file != NULL;
+    if (ok)
+    {
+        ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && (driver.empty() || std::fwrite(&driver[0], driver.size(), 1, file) == 1);
+        for (std::map<uint64_t, ProgramBinary>::const_iterator it = programs.begin(); ok && it != programs.end(); ++it)
+        {
+            ShaderCacheRecord record;
+            record.key = it->first;
+            record.checksum = checksum(&it->second.data[0], it->second.data.size());
+            record.format = it->second.format;
+            record.size = (uint32_t)it->second.data.size();
+            ok = std::fwrite(&record, sizeof(record), 1, file) == 1
+                && std::fwrite(&it->second.data[0], record.size, 1, file) == 1;
+        }
+        ok = std::fclose(file) == 0 && ok;
+    }
+    if (ok)
+    {
+        std::remove(path.c_str());
+        ok = std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+    else if (file)
+    {
+        std::remove(temporary.c_str());
+    }
+    if (!ok)
+        std::cout << "ERROR::SHADER_CACHE::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// report
+///////////////////////////////////////////////////////////////////////////////
+void ShaderCache::printSummary()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loaded + compiled + refused == 0)
+        return;
+
+    char line[256];
+    int length = std::snprintf(line, sizeof(line), "Shaders: %u programs linked from cached binaries in %.1f ms, %u compiled from source in %.1f ms",
+        loaded, loadMs, compiled, compileMs);
+    if (refused && length > 0 && length < (int)sizeof(line))
+        length += std::snprintf(line + length, sizeof(line) - length, ", %u cached binaries refused by the driver", refused);
+    if (unsupported && length > 0 && length < (int)sizeof(line))
+        std::snprintf(line + length, sizeof(line) - length, ", the driver hands out no program binaries");
+    std::cout << line << std::endl;
+
+    loaded = compiled = refused = 0;
+    loadMs = compileMs = 0.0;
+    unsupported = false;
+}
@@ -0,0 +1,194 @@
+#include <header/GLState.h>
+#include <header/RenderBackend.h>
+#include <header/ShaderVariants.h>
+#include <header/shader_m.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+ShaderVariants::ShaderVariants() : featureNames(NULL), featureCount(0), backend(NULL), queueHead(0), queueCount(0),
+    loading(false), stopping(false), compiledInBackground(0), compiledInPlace(0), waits(0), waitMs(0.0)
+{
+    for (unsigned int i = 0; i < (1u << SHADER_MAX_FEATURES); ++i)
+    {
+        variants[i] = NULL;
+        requested[i] = false;
+    }
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    destroy();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// loader thread
+///////////////////////////////////////////////////////////////////////////////
+void ShaderVariants::create(const char* vertexPath, const char* fragmentPath, const char* const* featureNames,
+    unsigned int featureCount, RenderBackend* backend)
+{
+    destroy();
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+    this->featureNames = featureNames;
+    this->featureCount = featureCount < SHADER_MAX_FEATURES ? featureCount : SHADER_MAX_FEATURES;
+    this->backend = backend;
+    compiledInBackground = compiledInPlace = waits = 0;
+    waitMs = 0.0;
+
+    // the loader thread is told apart by having its context, without one everything is compiled in place
+    loading = backend != NULL && backend->createLoaderContext();
+    if (loading)
+        loader = std::thread(&ShaderVariants::load, this);
+}
+
+void ShaderVariants::destroy()
+{
+    if (loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        variantQueued.notify_all();
+        loader.join();
+    }
+
+    for (unsigned int i = 0; i < (1u << SHADER_MAX_FEATURES); ++i)
+    {
+        if (variants[i])
+        {
+            glState.deleteProgram(variants[i]->ID);
+            delete variants[i];
+            variants[i] = NULL;
+        }
+        requested[i] = false;
+    }
+    queueHead = queueCount = 0;
+    loading = stopping = false;
+    backend = NULL;
+}
+
+void ShaderVariants::load()
+{
+    if (!backend->makeLoaderContextCurrent())
+    {
+        std::cout << "ERROR::SHADER_VARIANTS::LOADER_CONTEXT_NOT_CURRENT: compiling on the render thread" << std::endl;
+        std::lock_guard<std::mutex> lock(mutex);
+        loading = false;
+        variantCompiled.notify_all();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        while (!stopping && queueCount == 0)
+            variantQueued.wait(lock);
+        if (stopping)
+            break;
+        unsigned int features = queued[queueHead];
+        queueHead = (queueHead + 1) % (1u << SHADER_MAX_FEATURES);
+        --queueCount;
+
+        // the render context may use the program once the driver is done with it
+        lock.unlock();
+        Shader* shader = compile(features);
+        glFinish();
+        lock.lock();
+
+        variants[features] = shader;
+        ++compiledInBackground;
+        variantCompiled.notify_all();
+    }
+    lock.unlock();
+    backend->releaseLoaderContext();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// variants
+///////////////////////////////////////////////////////////////////////////////
+void ShaderVariants::request(unsigned int features)
+{
+    features &= (1u << featureCount) - 1;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!loading || requested[features] || variants[features])
+            return;
+        requested[features] = true;
+        queued[(queueHead + queueCount) % (1u << SHADER_MAX_FEATURES)] = features;
+        ++queueCount;
+    }
+    variantQueued.notify_one();
+}
+
+Shader& ShaderVariants::get(unsigned int features)
+{
+    features &= (1u << featureCount) - 1;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (variants[features])
+        return *variants[features];
+
+    // queued or being compiled on the loader thread
+    if (requested[features] && loading)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (variants[features] == NULL && loading)
+            variantCompiled.wait(lock);
+        ++waits;
+        waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (variants[features])
+            return *variants[features];
+    }
+
+    // the loader thread never takes a variant that was not queued, or has stopped for good
+    lock.unlock();
+    Shader* shader = compile(features);
+    lock.lock();
+    variants[features] = shader;
+    ++compiledInPlace;
+    return *shader;
+}
+
+// the features of the mask become defines, by name
+Shader* ShaderVariants::compile(unsigned int features) const
+{
+    std::string defines;
+    for (unsigned int i = 0; i < featureCount; ++i)
+    {
+        if (features & (1u << i))
+        {
+            if (!defines.empty())
+                defines += ' ';
+            defines += featureNames[i];
+        }
+    }
+    return new Shader(vertexPath.c_str(), fragmentPath.c_str(), NULL, defines.c_str());
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// report
+///////////////////////////////////////////////////////////////////////////////
+void ShaderVariants::printSummary()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (compiledInBackground + compiledInPlace == 0)
+        return;
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "Shader variants of %s and %s: %u built on the loader thread, %u on the render thread, waited %u times for %.1f ms",
+        vertexPath.c_str(), fragmentPath.c_str(), compiledInBackground, compiledInPlace, waits, waitMs);
+    std::cout << line << std::endl;
+}
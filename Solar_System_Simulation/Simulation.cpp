@@ -0,0 +1,462 @@
+#include <header/Simulation.h>
+#include <header/Checkpoint.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+// constants //////////////////////////////////////////////////////////////////
+const double GM_SUN = 2.959122082855911e-4;    // Gaussian gravitational constant squared, AU^3/day^2
+
+// mass of the sun divided by the mass of each body
+const double SUN_MASS_RATIO[SIM_BODY_COUNT] = {
+    1.0, 6023600.0, 408523.71, 328900.56, 3098708.0, 1047.3486, 3497.898, 22902.98, 19412.24
+};
+
+const char* const SIM_BODY_NAMES[SIM_BODY_COUNT] = {
+    "sun", "mercury", "venus", "earth", "mars", "jupiter", "saturn", "uranus", "neptune"
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+ScenarioConfig::ScenarioConfig() : name("default"), startYear(2000.0), years(100.0), stepDays(1.0)
+{
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+    {
+        massScale[i] = 1.0;
+        kick[i][0] = kick[i][1] = kick[i][2] = 0.0;
+    }
+}
+
+Simulation::Simulation()
+{
+    std::memset(&state, 0, sizeof(state));
+    std::memset(acceleration, 0, sizeof(acceleration));
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// initial state from the Keplerian elements, shifted to the barycentric frame
+///////////////////////////////////////////////////////////////////////////////
+void Simulation::reset(const ScenarioConfig& config)
+{
+    std::memset(&state, 0, sizeof(state));
+    state.day = (config.startYear - 2000.0) * 365.25;
+    state.stepDays = config.stepDays;
+
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+    {
+        state.gm[i] = GM_SUN / SUN_MASS_RATIO[i] * config.massScale[i];
+        if (i != SIM_SUN)
+        {
+            // velocity from a central difference of the orbit
+            glm::dvec3 p = keplerPosition(i - 1, state.day);
+            glm::dvec3 v = (keplerPosition(i - 1, state.day + 0.5) - keplerPosition(i - 1, state.day - 0.5));
+            for (int k = 0; k < 3; ++k)
+            {
+                state.position[i][k] = p[k];
+                state.velocity[i][k] = v[k];
+            }
+        }
+        for (int k = 0; k < 3; ++k)
+            state.velocity[i][k] += config.kick[i][k];
+    }
+
+    // move the origin to the barycenter so the system does not drift
+    double totalGm = 0.0, center[3] = { 0.0, 0.0, 0.0 }, momentum[3] = { 0.0, 0.0, 0.0 };
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+    {
+        totalGm += state.gm[i];
+        for (int k = 0; k < 3; ++k)
+        {
+            center[k] += state.gm[i] * state.position[i][k];
+            momentum[k] += state.gm[i] * state.velocity[i][k];
+        }
+    }
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            state.position[i][k] -= center[k] / totalGm;
+            state.velocity[i][k] -= momentum[k] / totalGm;
+        }
+
+    computeAccelerations();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// kick-drift-kick leapfrog, the accelerations of the last drift are reused by the next kick
+///////////////////////////////////////////////////////////////////////////////
+void Simulation::step()
+{
+    double dt = state.stepDays;
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            state.velocity[i][k] += 0.5 * dt * acceleration[i][k];
+            state.position[i][k] += dt * state.velocity[i][k];
+        }
+
+    computeAccelerations();
+
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+        for (int k = 0; k < 3; ++k)
+            state.velocity[i][k] += 0.5 * dt * acceleration[i][k];
+
+    state.day += dt;
+    ++state.step;
+}
+
+void Simulation::run(uint64_t steps)
+{
+    for (uint64_t s = 0; s < steps; ++s)
+        step();
+}
+
+// the accelerations are a pure function of the positions, so recomputing them here
+// continues exactly as the run that saved the state would have
+void Simulation::setState(const SimulationState& s)
+{
+    state = s;
+    computeAccelerations();
+}
+
+void Simulation::computeAccelerations()
+{
+    std::memset(acceleration, 0, sizeof(acceleration));
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+        for (int j = i + 1; j < SIM_BODY_COUNT; ++j)
+        {
+            double d[3] = {
+                state.position[j][0] - state.position[i][0],
+                state.position[j][1] - state.position[i][1],
+                state.position[j][2] - state.position[i][2]
+            };
+            double r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            double inv = 1.0 / (r2 * std::sqrt(r2));
+            for (int k = 0; k < 3; ++k)
+            {
+                acceleration[i][k] += state.gm[j] * d[k] * inv;
+                acceleration[j][k] -= state.gm[i] * d[k] * inv;
+            }
+        }
+}
+
+double Simulation::energy() const
+{
+    double kinetic = 0.0, potential = 0.0;
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+    {
+        const double* v = state.velocity[i];
+        kinetic += 0.5 * state.gm[i] * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (int j = i + 1; j < SIM_BODY_COUNT; ++j)
+        {
+            double dx = state.position[j][0] - state.position[i][0];
+            double dy = state.position[j][1] - state.position[i][1];
+            double dz = state.position[j][2] - state.position[i][2];
+            potential -= state.gm[i] * state.gm[j] / std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+    return kinetic + potential;
+}
+
+glm::dvec3 Simulation::heliocentric(int body) const
+{
+    return glm::dvec3(state.position[body][0] - state.position[SIM_SUN][0],
+        state.position[body][1] - state.position[SIM_SUN][1],
+        state.position[body][2] - state.position[SIM_SUN][2]);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// scenario file: whitespace separated key=value pairs, one scenario per line
+///////////////////////////////////////////////////////////////////////////////
+static int findBody(const std::string& name)
+{
+    for (int i = 0; i < SIM_BODY_COUNT; ++i)
+        if (name == SIM_BODY_NAMES[i])
+            return i;
+    return -1;
+}
+
+bool loadScenarios(const char* path, std::vector<ScenarioConfig>& scenarios)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::SCENARIO::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream tokens(line);
+        std::string token;
+        ScenarioConfig config;
+        bool any = false;
+        while (tokens >> token)
+        {
+            std::size_t eq = token.find('=');
+            std::string key = token.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : token.substr(eq + 1);
+            std::size_t dot = key.find('.');
+            int body = dot == std::string::npos ? -1 : findBody(key.substr(dot + 1));
+
+            if (key == "name")
+                config.name = value;
+            else if (key == "start")
+                config.startYear = std::atof(value.c_str());
+            else if (key == "years")
+                config.years = std::atof(value.c_str());
+            else if (key == "step")
+                config.stepDays = std::atof(value.c_str());
+            else if (key.compare(0, dot, "mass") == 0 && body >= 0)
+                config.massScale[body] = std::atof(value.c_str());
+            else if (key.compare(0, dot, "kick") == 0 && body >= 0)
+                std::sscanf(value.c_str(), "%lf,%lf,%lf", &config.kick[body][0], &config.kick[body][1], &config.kick[body][2]);
+            else
+            {
+                std::cout << "ERROR::SCENARIO::UNKNOWN_KEY: " << path << ":" << lineNumber << " " << token << std::endl;
+                return false;
+            }
+            any = true;
+        }
+
+        if (any)
+        {
+            if (config.stepDays <= 0.0 || config.years <= 0.0)
+            {
+                std::cout << "ERROR::SCENARIO::INVALID_DURATION: " << path << ":" << lineNumber << std::endl;
+                return false;
+            }
+            scenarios.push_back(config);
+        }
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// run one scenario, tracking distances and comparing with the unperturbed orbits at the end
+///////////////////////////////////////////////////////////////////////////////
+ScenarioResult runScenario(const ScenarioConfig& config, CheckpointWriter* checkpoints,
+    uint64_t checkpointEvery, const std::string& checkpointDir)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    Simulation simulation;
+    simulation.reset(config);
+
+    ScenarioResult result;
+    result.name = config.name;
+    result.steps = (uint64_t)std::ceil(config.years * 365.25 / config.stepDays);
+    result.memoryBytes = sizeof(Simulation) + sizeof(ScenarioResult);
+    for (int p = 0; p < EPH_BODY_COUNT; ++p)
+    {
+        result.minDistance[p] = 1e300;
+        result.maxDistance[p] = 0.0;
+    }
+
+    // one file per checkpointed step, so two steps of a run can be replayed and compared
+    std::string checkpointPrefix = checkpointDir + "/" + config.name + "_";
+    CheckpointData checkpoint;
+    std::memset(&checkpoint, 0, sizeof(checkpoint));
+    checkpoint.hasSimulation = 1;
+    std::strncpy(checkpoint.scenario, config.name.c_str(), sizeof(checkpoint.scenario) - 1);
+
+    double initialEnergy = simulation.energy();
+    for (uint64_t s = 0; s < result.steps; ++s)
+    {
+        simulation.step();
+        for (int p = 0; p < EPH_BODY_COUNT; ++p)
+        {
+            double r = glm::length(simulation.heliocentric(p + 1));
+            result.minDistance[p] = std::fmin(result.minDistance[p], r);
+            result.maxDistance[p] = std::fmax(result.maxDistance[p], r);
+        }
+
+        if (checkpoints && checkpointEvery && (s + 1) % checkpointEvery == 0)
+        {
+            checkpoint.simulation = simulation.getState();
+            checkpoints->submit((checkpointPrefix + std::to_string(s + 1) + ".chk").c_str(), checkpoint);
+        }
+    }
+
+    double finalDay = simulation.getState().day;
+    for (int p = 0; p < EPH_BODY_COUNT; ++p)
+        result.keplerDeviation[p] = glm::length(simulation.heliocentric(p + 1) - keplerPosition(p, finalDay));
+    result.energyError = std::fabs((simulation.energy() - initialEnergy) / initialEnergy);
+    result.ok = std::isfinite(result.energyError);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// peak resident memory of the process, in bytes
+///////////////////////////////////////////////////////////////////////////////
+static std::size_t peakMemoryBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (std::size_t)usage.ru_maxrss;
+#else
+    return (std::size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// workers take the next scenario index until none are left, results land in a
+// preallocated slot per scenario so no locking is needed
+///////////////////////////////////////////////////////////////////////////////
+int runScenarios(const std::vector<ScenarioConfig>& scenarios, int threads, const char* outputPath,
+    uint64_t checkpointEvery, const std::string& checkpointDir)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    if (threads > (int)scenarios.size())
+        threads = (int)scenarios.size();
+
+    std::vector<ScenarioResult> results(scenarios.size());
+    std::atomic<int> next(0);
+    CheckpointWriter checkpoints;
+    CheckpointWriter* writer = checkpointEvery ? &checkpoints : NULL;
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&]() {
+            for (int i = next++; i < (int)scenarios.size(); i = next++)
+                results[i] = runScenario(scenarios[i], writer, checkpointEvery, checkpointDir);
+        }));
+    }
+    for (std::size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+    checkpoints.flush();
+
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::ofstream output(outputPath);
+    if (!output)
+    {
+        std::cout << "ERROR::SCENARIO::FILE_NOT_SUCCESSFULLY_WRITTEN: " << outputPath << std::endl;
+        return -1;
+    }
+    output.precision(10);
+    output << "name,steps,seconds,energy_error,memory_bytes";
+    for (int p = 0; p < EPH_BODY_COUNT; ++p)
+        output << "," << SIM_BODY_NAMES[p + 1] << "_deviation_au," << SIM_BODY_NAMES[p + 1] << "_min_au," << SIM_BODY_NAMES[p + 1] << "_max_au";
+    output << "\n";
+
+    double scenarioSeconds = 0.0;
+    int failed = 0;
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const ScenarioResult& r = results[i];
+        output << r.name << "," << r.steps << "," << r.seconds << "," << r.energyError << "," << r.memoryBytes;
+        for (int p = 0; p < EPH_BODY_COUNT; ++p)
+            output << "," << r.keplerDeviation[p] << "," << r.minDistance[p] << "," << r.maxDistance[p];
+        output << "\n";
+
+        scenarioSeconds += r.seconds;
+        if (!r.ok)
+        {
+            std::cout << "Scenario " << r.name << " diverged" << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Ran " << scenarios.size() << " scenarios on " << threads << " threads in " << wallSeconds << " s"
+        << " (parallel speedup " << (wallSeconds > 0.0 ? scenarioSeconds / wallSeconds : 0.0) << "x)\n"
+        << "  memory per scenario: " << sizeof(Simulation) + sizeof(ScenarioResult) << " bytes"
+        << ", peak process memory: " << peakMemoryBytes() / 1024 << " KB\n"
+        << "  summary written to " << outputPath << std::endl;
+    if (writer)
+        std::cout << "  checkpoints written: " << checkpoints.getWritten() << ", superseded before writing: "
+            << checkpoints.getReplaced() << ", failed: " << checkpoints.getFailed() << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+int runBatch(int argc, char** argv)
+{
+    const char* scenarioPath = NULL;
+    const char* outputPath = "scenario_results.csv";
+    const char* checkpointDir = ".";
+    uint64_t checkpointEvery = 0;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            scenarioPath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+            checkpointEvery = std::strtoull(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--checkpoint-dir") == 0 && i + 1 < argc)
+            checkpointDir = argv[++i];
+    }
+
+    std::vector<ScenarioConfig> scenarios;
+    if (!scenarioPath || !loadScenarios(scenarioPath, scenarios))
+    {
+        std::cout << "usage: --batch <scenario file> [--threads N] [--output file]"
+            " [--checkpoint-every N] [--checkpoint-dir dir]" << std::endl;
+        return -1;
+    }
+    if (scenarios.empty())
+    {
+        std::cout << "No scenarios in " << scenarioPath << std::endl;
+        return 0;
+    }
+    return runScenarios(scenarios, threads, outputPath, checkpointEvery, checkpointDir);
+}
@@ -1,7 +1,80 @@
 #include <header/camera.h>
 #include <header/solar.h>
 
-int main() {
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv) {
+	// precompute the ephemeris file used by the scaled distance version
+	// usage: --build-ephemeris [file] [start year] [end year]
+	if (argc > 1 && std::strcmp(argv[1], "--build-ephemeris") == 0)
+	{
+		const char* path = argc > 2 ? argv[2] : EPHEMERIS_FILE;
+		double startYear = argc > 3 ? std::atof(argv[3]) : 2000.0;
+		double endYear = argc > 4 ? std::atof(argv[4]) : 2100.0;
+		return buildEphemeris(path, (startYear - 2000.0) * 365.25, (endYear - 2000.0) * 365.25) ? 0 : -1;
+	}
+
+	// write the synthetic star catalog drawn as background by both versions
+	// usage: --build-stars [file] [count]
+	if (argc > 1 && std::strcmp(argv[1], "--build-stars") == 0)
+	{
+		const char* path = argc > 2 ? argv[2] : STAR_CATALOG_FILE;
+		int count = argc > 3 ? std::atoi(argv[3]) : 1000000;
+		return count > 0 && buildStarCatalog(path, (unsigned int)count, 1) ? 0 : -1;
+	}
+
+	// run what-if n-body scenarios in parallel without opening a window
+	// usage: --batch <scenario file> [--threads N] [--output file] [--checkpoint-every N] [--checkpoint-dir dir]
+	if (argc > 1 && std::strcmp(argv[1], "--batch") == 0)
+	{
+		return runBatch(argc, argv);
+	}
+
+	// continue a batch checkpoint, optionally checking it against a later one
+	// usage: --replay <checkpoint> [--steps N] [--compare <checkpoint>]
+	if (argc > 1 && std::strcmp(argv[1], "--replay") == 0)
+	{
+		return runReplay(argc, argv);
+	}
+
+	// compare the closed-form body transforms with the glm rotate chain
+	// usage: --benchmark-transforms [body count]
+	if (argc > 1 && std::strcmp(argv[1], "--benchmark-transforms") == 0)
+	{
+		return benchmarkBodyTransforms(argc > 2 ? std::atoi(argv[2]) : 10000);
+	}
+
+	// draw either version into an offscreen framebuffer without a display, printing frame timings
+	// usage: --headless [--distance] [--black] [--frames N] [--frame-time seconds] [--capture file.ppm] [--trace file.json] [--overlay] [--heap-check] [--record file] [--size WxH]
+	if (argc > 1 && std::strcmp(argv[1], "--headless") == 0)
+	{
+		return runHeadless(argc, argv);
+	}
+
+	// fly the scripted camera paths through both versions offscreen and write the frame statistics as JSON
+	// usage: --benchmark [--paths file] [--output file.json] [--frames N] [--frame-time seconds] [--warmup N] [--mode size|distance] [--black]
+	if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+	{
+		return runBenchmark(argc, argv);
+	}
+
+	// time the GPU asteroid belt at several particle counts
+	// usage: --benchmark-belt [count ...]
+	if (argc > 1 && std::strcmp(argv[1], "--benchmark-belt") == 0)
+	{
+		return benchmarkAsteroidBelt(argc, argv);
+	}
+
+#ifdef SOLAR_NO_WINDOW
+	// built without GLFW there are no interactive versions, the flythrough benchmark runs instead
+	if (argc > 1)
+	{
+		std::cout << "ERROR::MAIN::NO_WINDOW: built without GLFW, unknown mode " << argv[1] << std::endl;
+		return -1;
+	}
+	return runBenchmark(argc, argv);
+#else
 	bool scaledSize = true;
 	bool backgroundBlack = false;
 
@@ -14,11 +87,12 @@ int main() {
 	if (scaledSize) 
 	{
 		camera = Camera(glm::vec3(0.0f, 0.0f, 80.0f));
-		return solarScaledSize(backgroundBlack);
+		return solarScaledSize(backgroundBlack, BackendOptions());
 	}
 	else 
 	{
 		camera = Camera(glm::vec3(0.0f, 0.0f, 20.0f));
-		return solarScaledDistance(backgroundBlack);
+		return solarScaledDistance(backgroundBlack, BackendOptions());
 	}
+#endif
 }
\ No newline at end of file
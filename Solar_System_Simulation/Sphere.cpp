@@ -16,7 +16,7 @@ const int MIN_STACK_COUNT = 2;
 ///////////////////////////////////////////////////////////////////////////////
 // ctor
 ///////////////////////////////////////////////////////////////////////////////
-Sphere::Sphere(float radius, int sectors, int stacks, bool smooth, int up, int textureInt, int textureGL, unsigned int texture) : interleavedStride(32) // only contain vertices & texture, so stride = sizeof(float)*5 = 20
+Sphere::Sphere(float radius, int sectors, int stacks, bool smooth, int up, int textureInt, int textureGL, unsigned int texture) : vertexArray(0), vertexBuffer(0), indexBuffer(0), interleavedStride(32) // only contain vertices & texture, so stride = sizeof(float)*5 = 20
 {
     set(radius, sectors, stacks, smooth, up, textureInt, textureGL, texture);
 }
@@ -97,6 +97,13 @@ void Sphere::setTexture(int texture)
     this->texture = texture;
 }
 
+void Sphere::setBuffers(unsigned int vertexArray, unsigned int vertexBuffer, unsigned int indexBuffer)
+{
+    this->vertexArray = vertexArray;
+    this->vertexBuffer = vertexBuffer;
+    this->indexBuffer = indexBuffer;
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -194,13 +201,13 @@ void Sphere::buildVerticesSmooth()
 
     unsigned int k1, k2;
 
-    // generate indices
-    for (int i = 0; i <= stackCount; ++i)
+    // generate indices, stackCount x sectorCount quads between the rows of vertices
+    for (int i = 0; i < stackCount; ++i)
     {
         k1 = i * (sectorCount + 1); // start stack
         k2 = k1 + (sectorCount + 1); // end and start next stack
 
-        for (int j = 0; j <= sectorCount; ++j, ++k1, ++k2)
+        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2)
         {
             if (i != 0)
             {
@@ -0,0 +1,286 @@
+#include <header/Starfield.h>
+#include <header/Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+
+// constants //////////////////////////////////////////////////////////////////
+const char STAR_CATALOG_MAGIC[8] = { 'S', 'O', 'L', 'A', 'R', 'S', 'T', 'R' };
+const uint32_t STAR_CATALOG_VERSION = 1;
+const std::size_t STAR_CHUNK = 65536;               // stars per read, 1 MB
+const std::size_t MAX_QUEUED_STAR_CHUNKS = 4;
+const std::size_t MAX_STAR_UPLOADS_PER_FRAME = 2;
+const float STAR_REFERENCE_MAGNITUDE = 6.0f;        // naked-eye limit, drawn 2 pixels wide at full brightness
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+Starfield::Starfield() : shader(NULL), vertexArray(0), vertexBuffer(0), count(0), uploaded(0), stopping(false)
+{
+}
+
+Starfield::~Starfield()
+{
+    destroy();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the buffer holds the whole catalog from the start, chunks fill it in order
+///////////////////////////////////////////////////////////////////////////////
+bool Starfield::open(const char* path)
+{
+    destroy();
+
+    FILE* file = std::fopen(path, "rb");
+    if (!file)
+        return false;
+    StarCatalogHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1
+        || std::memcmp(header.magic, STAR_CATALOG_MAGIC, sizeof(header.magic)) != 0
+        || header.version != STAR_CATALOG_VERSION || header.count == 0)
+    {
+        std::cout << "ERROR::STARFIELD::INVALID_FILE: " << path << std::endl;
+        std::fclose(file);
+        return false;
+    }
+
+    shader = new Shader("stars.vs", "stars.fs");
+    shader->use();
+    shader->setFloat("referenceMagnitude", STAR_REFERENCE_MAGNITUDE);
+    count = header.count;
+    uploaded = 0;
+
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glState.bindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glState.bufferData(vertexBuffer, GL_ARRAY_BUFFER, (GLsizeiptr)count * sizeof(StarRecord), NULL, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarRecord), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StarRecord), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glState.bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    stopping = false;
+    reader = std::thread(&Starfield::readChunks, this, file);
+    return true;
+}
+
+void Starfield::destroy()
+{
+    if (reader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        drained.notify_all();
+        reader.join();
+    }
+    chunks.clear();
+
+    if (shader == NULL)
+        return;
+    glState.deleteVertexArray(vertexArray);
+    glState.deleteBuffer(vertexBuffer);
+    glState.deleteProgram(shader->ID);
+    delete shader;
+
+    shader = NULL;
+    vertexArray = vertexBuffer = 0;
+    count = uploaded = 0;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// reader thread: fixed-size chunks, waits while the render loop is behind
+///////////////////////////////////////////////////////////////////////////////
+void Starfield::readChunks(FILE* file)
+{
+    std::size_t remaining = count;
+    while (remaining > 0)
+    {
+        std::vector<StarRecord> chunk(std::min(remaining, STAR_CHUNK));
+        std::size_t read = std::fread(&chunk[0], sizeof(StarRecord), chunk.size(), file);
+        if (read == 0)
+        {
+            std::cout << "ERROR::STARFIELD::FILE_NOT_SUCCESSFULLY_READ: " << remaining << " stars missing" << std::endl;
+            break;
+        }
+        chunk.resize(read);
+        remaining -= read;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this]() { return stopping || chunks.size() < MAX_QUEUED_STAR_CHUNKS; });
+        if (stopping)
+            break;
+        chunks.push_back(std::vector<StarRecord>());
+        chunks.back().swap(chunk);
+    }
+    std::fclose(file);
+}
+
+void Starfield::update()
+{
+    if (shader == NULL || uploaded == count)
+        return;
+    ProfileScope scope(PROFILE_STARS);
+
+    // a couple of chunks per frame keeps the upload cost of a frame small
+    for (std::size_t i = 0; i < MAX_STAR_UPLOADS_PER_FRAME; ++i)
+    {
+        std::vector<StarRecord> chunk;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (chunks.empty())
+                break;
+            chunk.swap(chunks.front());
+            chunks.pop_front();
+        }
+        drained.notify_one();
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)uploaded * sizeof(StarRecord), chunk.size() * sizeof(StarRecord), &chunk[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uploaded += (unsigned int)chunk.size();
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// stars are directions, only the rotation of the view applies; drawn first,
+// added to the cleared background with the depth buffer untouched
+///////////////////////////////////////////////////////////////////////////////
+void Starfield::draw(const glm::mat4& projection, const glm::mat4& view)
+{
+    if (uploaded == 0)
+        return;
+    ProfileScope scope(PROFILE_STARS);
+
+    shader->use();
+    shader->setMat4("projection", projection);
+    shader->setMat4("view", glm::mat4(glm::mat3(view)));
+
+    glState.enable(GL_PROGRAM_POINT_SIZE);
+    glState.disable(GL_DEPTH_TEST);
+    glState.depthMask(false);
+    glState.enable(GL_BLEND);
+    glState.blendFunc(GL_SRC_ALPHA, GL_ONE);
+    glState.bindVertexArray(vertexArray);
+    glDrawArrays(GL_POINTS, 0, uploaded);
+    glState.countDraw(GL_POINTS, uploaded);
+    glState.disable(GL_BLEND);
+    glState.depthMask(true);
+    glState.enable(GL_DEPTH_TEST);
+    glState.disable(GL_PROGRAM_POINT_SIZE);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// synthetic catalog
+///////////////////////////////////////////////////////////////////////////////
+static void starColor(double bv, uint8_t color[3])
+{
+    // B-V to temperature (Ballesteros 2012), then a blackbody fit to sRGB
+    double t = 4600.0 * (1.0 / (0.92 * bv + 1.7) + 1.0 / (0.92 * bv + 0.62)) / 100.0;
+    double r, g, b;
+    if (t <= 66.0)
+    {
+        r = 255.0;
+        g = 99.4708025861 * std::log(t) - 161.1195681661;
+        b = t <= 19.0 ? 0.0 : 138.5177312231 * std::log(t - 10.0) - 305.0447927307;
+    }
+    else
+    {
+        r = 329.698727446 * std::pow(t - 60.0, -0.1332047592);
+        g = 288.1221695283 * std::pow(t - 60.0, -0.0755148492);
+        b = 255.0;
+    }
+    color[0] = (uint8_t)std::min(std::max(r, 0.0), 255.0);
+    color[1] = (uint8_t)std::min(std::max(g, 0.0), 255.0);
+    color[2] = (uint8_t)std::min(std::max(b, 0.0), 255.0);
+}
+
+bool buildStarCatalog(const char* path, unsigned int count, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> diskLatitude(0.0, glm::radians(12.0));
+    std::normal_distribution<double> colorIndex(0.65, 0.35);
+    const double TWO_PI = 6.283185307179586;
+    const double FAINTEST = 13.0;
+
+    // north galactic pole at ecliptic longitude 180.02, latitude 29.81 degrees
+    double poleLatitude = glm::radians(29.81), poleLongitude = glm::radians(180.02);
+    glm::dvec3 pole(std::cos(poleLatitude) * std::cos(poleLongitude), std::cos(poleLatitude) * std::sin(poleLongitude), std::sin(poleLatitude));
+    glm::dvec3 axisU = glm::normalize(glm::cross(pole, glm::dvec3(0.0, 0.0, 1.0)));
+    glm::dvec3 axisV = glm::cross(pole, axisU);
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+    {
+        std::cout << "ERROR::STARFIELD::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+    StarCatalogHeader header;
+    std::memcpy(header.magic, STAR_CATALOG_MAGIC, sizeof(header.magic));
+    header.version = STAR_CATALOG_VERSION;
+    header.count = count;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    std::vector<StarRecord> chunk;
+    chunk.reserve(STAR_CHUNK);
+    for (unsigned int i = 0; ok && i < count; ++i)
+    {
+        // two thirds in the disk, the rest anywhere
+        glm::dvec3 direction;
+        if (unit(random) < 0.67)
+        {
+            double longitude = TWO_PI * unit(random);
+            double latitude = diskLatitude(random);
+            direction = std::cos(latitude) * (std::cos(longitude) * axisU + std::sin(longitude) * axisV) + std::sin(latitude) * pole;
+        }
+        else
+        {
+            double z = 2.0 * unit(random) - 1.0;
+            double longitude = TWO_PI * unit(random);
+            double r = std::sqrt(1.0 - z * z);
+            direction = glm::dvec3(r * std::cos(longitude), r * std::sin(longitude), z);
+        }
+
+        // N(< m) grows as 10^(0.5 m), so m = faintest + 2 log10(u)
+        double magnitude = std::max(FAINTEST + 2.0 * std::log10(std::max(unit(random), 1e-12)), -1.5);
+
+        StarRecord star;
+        star.direction[0] = (float)direction.x;
+        star.direction[1] = (float)direction.z;
+        star.direction[2] = (float)-direction.y;
+        starColor(std::min(std::max(colorIndex(random), -0.3), 2.0), star.color);
+        star.magnitude = (uint8_t)std::min((magnitude + 2.0) * 16.0 + 0.5, 255.0);
+        chunk.push_back(star);
+
+        if (chunk.size() == STAR_CHUNK || i + 1 == count)
+        {
+            ok = std::fwrite(&chunk[0], sizeof(StarRecord), chunk.size(), file) == chunk.size();
+            chunk.clear();
+        }
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        std::cout << "ERROR::STARFIELD::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+    else
+        std::cout << "Star catalog written: " << path << ", " << count << " stars" << std::endl;
+    return ok;
+}
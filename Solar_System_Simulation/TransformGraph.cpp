@@ -0,0 +1,81 @@
+#include <header/TransformGraph.h>
+
+#include <algorithm>
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// storage
+///////////////////////////////////////////////////////////////////////////////
+void TransformGraph::reserve(unsigned int count)
+{
+    parents.reserve(count);
+    locals.reserve(count);
+    worlds.reserve(count);
+    dirty.reserve(count);
+}
+
+void TransformGraph::clear()
+{
+    parents.clear();
+    locals.clear();
+    worlds.clear();
+    dirty.clear();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// add a node, the parent must already exist so the arrays stay topologically sorted
+///////////////////////////////////////////////////////////////////////////////
+int TransformGraph::addNode(int parent, const glm::mat4& local)
+{
+    int index = (int)parents.size();
+    if (parent >= index)
+        parent = -1;
+
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(local);
+    dirty.push_back(1);
+    return index;
+}
+
+void TransformGraph::setLocal(int node, const glm::mat4& local)
+{
+    locals[node] = local;
+    dirty[node] = 1;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// one pass in storage order: a node is recomputed when it or its parent is dirty,
+// the flag is kept during the pass so it propagates to the whole subtree
+///////////////////////////////////////////////////////////////////////////////
+unsigned int TransformGraph::update()
+{
+    unsigned int updated = 0;
+    std::size_t count = parents.size();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int parent = parents[i];
+        if (parent >= 0)
+        {
+            dirty[i] |= dirty[parent];
+            if (dirty[i])
+            {
+                worlds[i] = worlds[parent] * locals[i];
+                ++updated;
+            }
+        }
+        else if (dirty[i])
+        {
+            worlds[i] = locals[i];
+            ++updated;
+        }
+    }
+
+    std::fill(dirty.begin(), dirty.end(), (unsigned char)0);
+    return updated;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in float Shade;
+
+uniform vec3 color;
+uniform vec3 origin;        // the sun, relative to the camera
+
+void main()
+{
+    // lit by the sun at the origin
+    vec3 lightDir = normalize(origin - FragPos);
+    float diff = max(dot(normalize(Normal), lightDir), 0.0);
+    FragColor = vec4(color * Shade * (0.2 + 0.8 * diff), 1.0);
+}
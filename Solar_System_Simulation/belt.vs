@@ -0,0 +1,30 @@
+#version 330 core
+#include "logdepth.glsl"
+
+layout (location = 0) in vec3 aPos;         // unit octahedron
+layout (location = 3) in vec4 aInstance;    // xyz: position, w: size, from the propagation pass
+
+out vec3 FragPos;
+out vec3 Normal;
+out float Shade;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 origin;        // world origin relative to the camera, the view only rotates
+
+void main()
+{
+    // stretch every rock differently so the belt does not look like copies of one mesh
+    float h = fract(sin(float(gl_InstanceID) * 12.9898) * 43758.5453);
+    vec3 stretch = vec3(0.8 + 0.5 * h, 1.1 - 0.4 * h, 0.7 + 0.6 * fract(h * 7.0));
+
+    // the belt lies within a few AU of the origin, so single precision world positions are enough there
+    FragPos = aPos * stretch * aInstance.w + aInstance.xyz + origin;
+    Normal = aPos / stretch;
+    Shade = 0.6 + 0.4 * fract(h * 13.0);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+
+    // logarithmic depth per vertex only, rocks are too small for the interpolation error to show
+    // and leaving gl_FragDepth alone keeps early depth testing for the whole belt
+    gl_Position = LogDepthClip(gl_Position);
+}
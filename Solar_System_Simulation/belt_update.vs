@@ -0,0 +1,27 @@
+#version 330 core
+// orbit of one particle, the ellipse axes are prescaled on the CPU:
+// position = axisA * (cos(E) - e) + axisB * sin(E), in scene orientation and AU
+layout (location = 0) in vec4 aAxisA;       // xyz: periapsis direction * a, w: eccentricity
+layout (location = 1) in vec4 aAxisB;       // xyz: normal direction * a * sqrt(1 - e^2), w: mean anomaly at J2000
+layout (location = 2) in vec2 aMotion;      // x: mean motion (rad/day), y: rock size
+
+out vec4 Position;                          // captured by transform feedback
+
+uniform float day;
+uniform float auScale;
+
+const float TWO_PI = 6.28318530718;
+
+void main()
+{
+    float e = aAxisA.w;
+    float M = mod(aAxisB.w + aMotion.x * day, TWO_PI);
+
+    // Newton iterations on Kepler's equation, three are plenty for e < 0.3
+    float E = M + e * sin(M);
+    for (int i = 0; i < 3; ++i)
+        E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+
+    vec3 p = aAxisA.xyz * (cos(E) - e) + aAxisB.xyz * sin(E);
+    Position = vec4(p * auScale, aMotion.y);
+}
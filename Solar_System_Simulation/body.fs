@@ -0,0 +1,120 @@
+#version 330 core
+// every celestial body, specialized by the defines of its variant (see ShaderVariants.h):
+//   EMISSIVE   unlit, the sun shows its texture as it is
+//   RINGED     the shadow of the planet's rings, looked up from the ring texture
+//   IMPOSTOR   the sphere is ray-cast from a quad (body.vs) and textured per pixel
+#include "logdepth.glsl"
+#include "lighting.glsl"
+
+out vec4 FragColor;
+
+in vec3 FragPos;        // on the quad for impostors, only used for the ray direction
+in float ViewDepth;
+
+uniform vec3 viewPos;
+uniform Material material;
+#ifndef EMISSIVE
+uniform PointLight pointLights;
+#endif
+
+#ifdef IMPOSTOR
+uniform vec3 center;
+uniform float radius;
+uniform mat3 orientation;   // rotation part of the body's model matrix
+uniform mat4 view;
+uniform mat4 projection;
+
+const float PI = 3.14159265359;
+
+vec2 TexCoords;
+vec2 TexCoordsDx;
+vec2 TexCoordsDy;
+
+// explicit gradients, the texture coordinates jump at the seam
+#define SAMPLE(sampler) textureGrad(sampler, TexCoords, TexCoordsDx, TexCoordsDy)
+#else
+in vec3 Normal;
+in vec2 TexCoords;
+
+#define SAMPLE(sampler) texture(sampler, TexCoords)
+#endif
+
+#ifdef RINGED
+uniform sampler2D ringTexture;
+uniform vec2 ringRadii;     // inner and outer radius
+uniform vec3 ringCenter;
+uniform vec3 ringNormal;
+
+// light let through by the rings: intersect the ray to the light with the ring plane and look up
+// the ring's opacity there, the same opacity ring.fs draws with
+float CalcRingShadow(vec3 fragPos, vec3 lightDir)
+{
+    float facing = dot(lightDir, ringNormal);
+    if (abs(facing) < 1e-6)
+        return 1.0;
+    float t = dot(ringCenter - fragPos, ringNormal) / facing;
+    if (t <= 0.0)
+        return 1.0;
+    float r = length(fragPos + t * lightDir - ringCenter);
+    float s = (r - ringRadii.x) / (ringRadii.y - ringRadii.x);
+    if (s < 0.0 || s > 1.0)
+        return 1.0;
+    // explicit level, the lookup is inside non-uniform control flow
+    vec3 albedo = textureLod(ringTexture, vec2(s, 0.5), 0.0).rgb;
+    return 1.0 - smoothstep(0.05, 0.5, dot(albedo, vec3(0.299, 0.587, 0.114)));
+}
+#endif
+
+void main()
+{
+#ifdef IMPOSTOR
+    // ray from the eye through this pixel against the sphere
+    vec3 rayDir = normalize(FragPos - viewPos);
+    vec3 oc = viewPos - center;
+    float b = dot(oc, rayDir);
+    float h = b * b - dot(oc, oc) + radius * radius;
+    if (h < 0.0)
+        discard;
+    vec3 fragPos = viewPos + rayDir * (-b - sqrt(h));
+    vec3 norm = (fragPos - center) / radius;
+
+    // logarithmic depth of the sphere surface, not of the quad
+    vec4 clip = projection * view * vec4(fragPos, 1.0);
+    gl_FragDepth = LogDepthFragment(max(clip.w, logDepth.x));
+
+    // same parameterization as Sphere: s along the sectors, t from the +Z pole
+    vec3 local = transpose(orientation) * norm;
+    TexCoords = vec2(atan(local.y, local.x) / (2.0 * PI), acos(clamp(local.z, -1.0, 1.0)) / PI);
+    TexCoords.x = fract(TexCoords.x);
+
+    // gradients without the jump at the s = 0 seam, so mipmapping stays correct
+    vec2 seam = vec2(fract(TexCoords.x + 0.5), TexCoords.y);
+    TexCoordsDx = dFdx(TexCoords);
+    TexCoordsDy = dFdy(TexCoords);
+    vec2 seamDx = dFdx(seam), seamDy = dFdy(seam);
+    if (abs(seamDx.x) + abs(seamDy.x) < abs(TexCoordsDx.x) + abs(TexCoordsDy.x))
+    {
+        TexCoordsDx = seamDx;
+        TexCoordsDy = seamDy;
+    }
+#else
+    vec3 fragPos = FragPos;
+    vec3 norm = normalize(Normal);
+
+    // per pixel, the depth interpolated from the vertices is only exact at the vertices
+    gl_FragDepth = LogDepthFragment(ViewDepth);
+#endif
+
+#ifdef EMISSIVE
+    FragColor = SAMPLE(material.diffuse);
+#else
+    float shadow = 1.0;
+#ifdef RINGED
+    shadow = CalcRingShadow(fragPos, normalize(pointLights.position - fragPos));
+#endif
+    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 result = CalcPointLight(pointLights, norm, fragPos, viewDir, material.shininess, vec3(SAMPLE(material.diffuse)),
+        vec3(SAMPLE(material.specular)), shadow);
+    FragColor = vec4(result, 1.0);
+#endif
+}
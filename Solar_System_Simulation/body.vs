@@ -0,0 +1,58 @@
+#version 330 core
+// every celestial body, specialized by the defines of its variant (see ShaderVariants.h):
+//   IMPOSTOR   camera-facing quad in front of the sphere, body.fs ray-casts the surface
+#include "logdepth.glsl"
+
+out vec3 FragPos;
+out float ViewDepth;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+#ifdef IMPOSTOR
+layout (location = 0) in vec2 aCorner;      // quad corner in [-1, 1]
+
+uniform vec3 center;
+uniform float radius;
+uniform vec3 viewPos;
+
+void main()
+{
+    // quad facing the eye, just in front of the sphere and large enough to cover its silhouette
+    vec3 toCenter = center - viewPos;
+    float d = length(toCenter);
+    vec3 dir = toCenter / d;
+    vec3 helper = abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(dir, helper));
+    vec3 up = cross(right, dir);
+
+    float quadDistance = max(d - radius, 1e-4);
+    float halfSize = quadDistance * radius / sqrt(max(d * d - radius * radius, 1e-8));
+
+    FragPos = viewPos + dir * quadDistance + (aCorner.x * right + aCorner.y * up) * halfSize;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+
+    ViewDepth = gl_Position.w;
+    gl_Position = LogDepthClip(gl_Position);
+}
+#else
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+uniform mat4 model;
+
+out vec3 Normal;
+out vec2 TexCoords;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+
+    ViewDepth = gl_Position.w;
+    gl_Position = LogDepthClip(gl_Position);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoords = aTexCoords;
+}
+#endif
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// Annulus.h
+// =========
+// Flat ring for OpenGL with (innerRadius, outerRadius, sectors), lying in the XY
+// plane with +Z normal, the equatorial plane of a Sphere with the default up axis.
+// Interleaved V/N/T with the same 32 byte stride as Sphere, s runs from the inner
+// to the outer edge and t around the ring.
+// The outer edge circumscribes the circle, so a shader that discards by radius
+// (see ring.fs) gets exactly round edges from a coarse polygon.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GEOMETRY_ANNULUS_H
+#define GEOMETRY_ANNULUS_H
+
+#include <vector>
+
+class Annulus
+{
+public:
+    // ctor/dtor
+    Annulus(float innerRadius=1.0f, float outerRadius=2.0f, int sectorCount=64, int textureInt=0, int textureGL=GL_TEXTURE0, unsigned int texture=0);
+    ~Annulus() {}
+
+    // getters/setters
+    float getInnerRadius() const            { return innerRadius; }
+    float getOuterRadius() const            { return outerRadius; }
+    int getSectorCount() const              { return sectorCount; }
+    void set(float innerRadius, float outerRadius, int sectorCount);
+    void setTextureInt(int textureInt)      { this->textureInt = textureInt; }
+    void setTextureGL(int textureGL)        { this->textureGL = textureGL; }
+    void setTexture(int texture)            { this->texture = texture; }
+    int getTextureInt() const               { return textureInt; }
+    int getTextureGL() const                { return textureGL; }
+    int getTexture() const                  { return texture; }
+
+    // GL objects of the uploaded mesh, 0 until uploaded
+    void setBuffers(unsigned int vertexArray, unsigned int vertexBuffer, unsigned int indexBuffer);
+    unsigned int getVertexArray() const     { return vertexArray; }
+    unsigned int getVertexBuffer() const    { return vertexBuffer; }
+    unsigned int getIndexBuffer() const     { return indexBuffer; }
+
+    // for interleaved vertices: V/N/T
+    unsigned int getInterleavedVertexCount() const  { return (unsigned int)interleavedVertices.size() / 8; }
+    unsigned int getInterleavedVertexSize() const   { return (unsigned int)interleavedVertices.size() * sizeof(float); }
+    int getInterleavedStride() const                { return 8 * sizeof(float); }
+    const float* getInterleavedVertices() const     { return interleavedVertices.data(); }
+    unsigned int getIndexCount() const      { return (unsigned int)indices.size(); }
+    unsigned int getIndexSize() const       { return (unsigned int)indices.size() * sizeof(unsigned int); }
+    const unsigned int* getIndices() const  { return indices.data(); }
+
+private:
+    void buildVertices();
+
+    float innerRadius;
+    float outerRadius;
+    int sectorCount;
+    int textureInt;
+    int textureGL;
+    unsigned int texture;
+    unsigned int vertexArray, vertexBuffer, indexBuffer;
+    std::vector<float> interleavedVertices;
+    std::vector<unsigned int> indices;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ASTEROID_BELT_H
+#define ASTEROID_BELT_H
+
+#include <header/shader_m.h>
+
+#include <glm/glm.hpp>
+
+// Particles drawn by the scaled distance version
+const unsigned int ASTEROID_COUNT = 200000;
+
+// Random orbits of one belt, in AU and degrees
+struct AsteroidBeltConfig
+{
+    unsigned int count;
+    float innerAU;              // semi-major axis range
+    float outerAU;
+    float maxEccentricity;
+    float maxInclination;
+    float minSize;              // rock radius, scene units
+    float maxSize;
+    unsigned int seed;
+
+    AsteroidBeltConfig();       // main belt between Mars and Jupiter
+};
+
+// Asteroid or Kuiper belt kept entirely on the GPU. The orbital elements are uploaded once;
+// every frame a transform feedback pass solves Kepler's equation per particle into a
+// position buffer, which then feeds one instanced draw of a low-poly rock. The CPU only
+// issues two draw calls, whatever the particle count.
+class AsteroidBelt
+{
+public:
+    AsteroidBelt();
+    ~AsteroidBelt();
+
+    bool create(const AsteroidBeltConfig& config);
+    void destroy();                                 // needs the GL context, call before it is gone
+
+    // propagate every particle to a day since J2000, auScale scene units per AU
+    void update(double day, float auScale);
+    void draw(const glm::mat4& projection, const glm::mat4& view, const glm::dvec3& eye);  // camera-relative view
+
+    unsigned int getCount() const               { return count; }
+    unsigned int getPositionBuffer() const      { return positionBuffer; }  // vec4(position, size) per particle
+    unsigned int getMemoryBytes() const;
+
+private:
+    AsteroidBelt(const AsteroidBelt&);
+    AsteroidBelt& operator=(const AsteroidBelt&);
+
+    Shader* updateShader;
+    Shader* drawShader;
+    unsigned int count;
+    unsigned int indexCount;
+    unsigned int elementBuffer;     // per particle orbit, constant
+    unsigned int positionBuffer;    // written by transform feedback
+    unsigned int meshBuffer, meshIndexBuffer;
+    unsigned int updateVAO, drawVAO;
+};
+
+// command line entry point: --benchmark-belt [count ...]
+int benchmarkAsteroidBelt(int argc, char** argv);
+
+#endif
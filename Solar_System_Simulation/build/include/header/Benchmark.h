@@ -0,0 +1,57 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <header/camera.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Default flythrough file read by --benchmark
+const char* const FLYTHROUGH_FILE = "flythroughs.txt";
+
+// Version a camera path is flown through
+enum BenchmarkMode
+{
+    BENCHMARK_SIZE,             // solarScaledSize
+    BENCHMARK_DISTANCE          // solarScaledDistance
+};
+
+// Camera at one moment of a path
+struct CameraKey
+{
+    double time;                // seconds of simulated time from the start of the path
+    glm::dvec3 position;        // scene units
+    float yaw, pitch;           // degrees, as Camera keeps them
+    float zoom;                 // vertical field of view, degrees
+};
+
+// Scripted camera flight, standing in for processInput and mouse_callback during a benchmark.
+// Positions follow a Catmull-Rom spline through the keys so the camera passes every key without
+// jumps in speed, the angles are interpolated linearly; before the first and after the last key
+// the camera holds still. Read from a flythrough file such as
+//   name=tour mode=size
+//   t=0 pos=0,0,80 yaw=-90 pitch=0 zoom=45
+//   t=5 pos=60,20,60 yaw=-135 pitch=-15 zoom=45
+class CameraPath
+{
+public:
+    CameraPath();
+
+    void apply(double time, Camera& camera) const;
+    double duration() const;
+
+    std::string name;
+    int mode;                   // BenchmarkMode
+    std::vector<CameraKey> keys;    // by increasing time
+};
+
+// parse a flythrough file, '#' starts a comment
+bool loadCameraPaths(const char* path, std::vector<CameraPath>& paths);
+
+// fly every path offscreen with a fixed simulation step and write the frame statistics as JSON,
+// options after --benchmark on the command line
+int runBenchmark(int argc, char** argv);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef BODY_TRANSFORM_H
+#define BODY_TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Closed-form model matrices for many bodies, replacing the per-body glm rotate chain
+//   orbit = rotate(orbitAngle, Y) * translate(distance, 0, 0), plus offset
+//   model = orbit * tilt * rotate(spinAngle, Y)
+// tilt = rotate(radians(360 - rotationAxis), (1, 0, 1)) * rotate(90, X) is precomputed per body as a
+// quaternion, so a frame only needs two sin/cos pairs per body. Inputs are stored as structure of
+// arrays and processed in flat loops the compiler can vectorize across bodies.
+// The orbit translation is also kept in double precision as the body's world position, which the
+// renderer makes camera-relative before it is rounded to float (see Camera::GetViewMatrix).
+// The translation column of the float matrices is only exact enough near the world origin.
+class BodyTransformBatch
+{
+public:
+    BodyTransformBatch() {}
+
+    void reserve(unsigned int count);
+    void clear();
+
+    // add a body with its axial tilt in degrees, returns its index
+    int add(float rotationAxis);
+    void setTilt(int body, float rotationAxis);
+
+    // per-frame inputs, angles in radians (|angle| < 1e6)
+    void set(int body, double orbitAngle, double distance, float spinAngle)
+    {
+        orbitAngles[body] = (float)orbitAngle;
+        distances[body] = (float)distance;
+        spinAngles[body] = spinAngle;
+        exactOrbitAngles[body] = orbitAngle;
+        exactDistances[body] = distance;
+    }
+    void setOffset(int body, const glm::dvec3& offset)
+    {
+        offsetX[body] = (float)offset.x;
+        offsetY[body] = (float)offset.y;
+        offsetZ[body] = (float)offset.z;
+        exactOffsets[body] = offset;
+    }
+
+    // compute orbit and model matrices of every body
+    void compose();
+
+    // compute the double-precision orbit translations, the positions of bodies around a fixed parent
+    void composePositions();
+
+    unsigned int getCount() const                   { return (unsigned int)orbitAngles.size(); }
+    const glm::quat& getTilt(int body) const        { return tilts[body]; }
+    const glm::mat4& getOrbit(int body) const       { return orbits[body]; }
+    const glm::mat4& getModel(int body) const       { return models[body]; }
+    glm::mat4& getModel(int body)                   { return models[body]; }
+    const glm::mat4* getModels() const              { return models.data(); }
+    const glm::dvec3& getPosition(int body) const   { return positions[body]; }
+    glm::dvec3& getPosition(int body)               { return positions[body]; }
+
+private:
+    // inputs
+    std::vector<float> orbitAngles, distances, spinAngles;
+    std::vector<float> offsetX, offsetY, offsetZ;
+    std::vector<glm::quat> tilts;
+    std::vector<float> tiltMatrix[9];       // tilt as column-major 3x3, one array per element
+    std::vector<double> exactOrbitAngles, exactDistances;
+    std::vector<glm::dvec3> exactOffsets;
+
+    // scratch, sized with the inputs so compose() never allocates
+    std::vector<float> sinOrbit, cosOrbit, sinSpin, cosSpin;
+
+    // outputs
+    std::vector<glm::mat4> orbits;
+    std::vector<glm::mat4> models;
+    std::vector<glm::dvec3> positions;
+};
+
+// tilt quaternion of a body, rotationAxis in degrees
+glm::quat bodyTilt(float rotationAxis);
+
+// reference composition with the glm rotate chain
+glm::mat4 bodyModelReference(float orbitAngle, float distance, float rotationAxis, float spinAngle);
+
+// check the kernel against the glm chain and time both for count bodies, returns 0 on success
+int benchmarkBodyTransforms(int count);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <header/Simulation.h>
+#include <header/SimulationClock.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Default checkpoint file of the interactive versions (F5 saves, F9 loads)
+const char* const CHECKPOINT_FILE = "solar.chk";
+
+// Camera pose, enough to rebuild the Camera
+struct CheckpointCamera
+{
+    double position[3];
+    float yaw;
+    float pitch;
+    float zoom;
+    float reserved;
+};
+
+// Everything a run needs to resume, plain data written as is
+struct CheckpointData
+{
+    SimulationClockState clock;
+    CheckpointCamera camera;
+    uint32_t hasSimulation;
+    uint32_t reserved;
+    char scenario[64];                  // scenario name of a batch run
+    SimulationState simulation;
+};
+
+// On-disk layout: header followed by CheckpointData, native endian
+struct CheckpointHeader
+{
+    char magic[8];                      // "SOLARCHK"
+    uint32_t version;
+    uint32_t size;                      // sizeof(CheckpointData)
+    uint64_t checksum;                  // FNV-1a of the data
+};
+
+bool writeCheckpoint(const char* path, const CheckpointData& data);
+bool readCheckpoint(const char* path, CheckpointData& data);
+
+// Writes checkpoints on a background thread. submit() only copies the data; a newer checkpoint
+// for a path still in the queue replaces the old one, and only when checkpoints of as many
+// other paths as the queue holds are pending does it wait for the disk, none is dropped.
+class CheckpointWriter
+{
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();
+
+    void submit(const char* path, const CheckpointData& data);
+    void flush();                       // wait until the queue is written
+
+    unsigned int getWritten() const     { return written; }
+    unsigned int getReplaced() const    { return replaced; }
+    unsigned int getFailed() const      { return failed; }
+
+private:
+    CheckpointWriter(const CheckpointWriter&);
+    CheckpointWriter& operator=(const CheckpointWriter&);
+
+    struct Job
+    {
+        std::string path;
+        CheckpointData data;
+    };
+
+    void work();
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::condition_variable space;      // a job left the queue
+    std::deque<Job> jobs;
+    bool busy;
+    bool stopping;
+    unsigned int written, replaced, failed;
+};
+
+// command line entry point: --replay <checkpoint> [--steps N] [--compare <checkpoint>]
+int runReplay(int argc, char** argv);
+
+#endif
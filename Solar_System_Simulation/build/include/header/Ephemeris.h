@@ -0,0 +1,88 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Planets stored in an ephemeris file, in the same order as the planet constants in Render.cpp
+enum Ephemeris_Body {
+    EPH_MERCURY,
+    EPH_VENUS,
+    EPH_EARTH,
+    EPH_MARS,
+    EPH_JUPITER,
+    EPH_SATURN,
+    EPH_URANUS,
+    EPH_NEPTUNE,
+    EPH_BODY_COUNT
+};
+
+// Default ephemeris file looked up by the scaled distance version
+const char* const EPHEMERIS_FILE = "solar.eph";
+
+// Days per simulated second, the render loops advance 1 year every 2*pi seconds
+const double EPHEMERIS_DAYS_PER_SECOND = 365.25 / 6.283185307179586;
+
+// On-disk layout, all values native endian
+// ------------------------------------------------------------------------
+// header | body records[bodyCount] | coefficients (double)
+// each body stores segmentCount segments, each segment 3 * (degree + 1) coefficients (x, y, z)
+struct EphemerisHeader
+{
+    char magic[8];              // "SOLAREPH"
+    uint32_t version;
+    uint32_t bodyCount;
+    double startDay;            // days since J2000
+    double endDay;
+};
+
+struct EphemerisBodyRecord
+{
+    uint32_t body;
+    uint32_t degree;
+    uint32_t segmentCount;
+    uint32_t reserved;
+    double segmentDays;
+    uint64_t coeffOffset;       // byte offset of the first coefficient from start of file
+};
+
+// Read-only view of a memory-mapped ephemeris file, positions in AU (ecliptic J2000)
+class Ephemeris
+{
+public:
+    Ephemeris();
+    ~Ephemeris();
+
+    bool open(const char* path);
+    void close();
+    bool isOpen() const                     { return data != NULL; }
+
+    double getStartDay() const              { return header ? header->startDay : 0.0; }
+    double getEndDay() const                { return header ? header->endDay : 0.0; }
+
+    // evaluate the position of a body for any day in the file range (clamped), O(1) per body
+    glm::dvec3 position(int body, double day) const;
+
+private:
+    Ephemeris(const Ephemeris&);
+    Ephemeris& operator=(const Ephemeris&);
+
+    const unsigned char* data;
+    std::size_t size;
+    const EphemerisHeader* header;
+    const EphemerisBodyRecord* records[EPH_BODY_COUNT];
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
+
+// Keplerian position of a planet in AU (ecliptic J2000), used to build the ephemeris file
+glm::dvec3 keplerPosition(int body, double day);
+
+// precompute Chebyshev segments for all planets between two dates and write them to path
+bool buildEphemeris(const char* path, double startDay, double endDay);
+
+#endif
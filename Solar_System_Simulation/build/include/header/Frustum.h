@@ -0,0 +1,40 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// the six planes (left, right, bottom, top, near, far) of a projection * view matrix,
+// normalized and facing inwards: a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+// Bounding spheres of every drawable body, tested against the view frustum in one batch.
+// Spheres are stored as structure of arrays and each plane is one flat loop over all of
+// them that the compiler vectorizes; the survivors are then compacted into an index list.
+class FrustumCuller
+{
+public:
+    FrustumCuller() {}
+
+    void resize(unsigned int count);
+    void setSphere(int index, const glm::vec3& center, float radius)
+    {
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        radii[index] = radius;
+    }
+
+    // fill visible with the indices of the spheres touching the frustum, in index order,
+    // returns their count
+    unsigned int cull(const glm::mat4& viewProjection, std::vector<int>& visible);
+
+    unsigned int getCount() const       { return (unsigned int)radii.size(); }
+
+private:
+    std::vector<float> centerX, centerY, centerZ, radii;
+    std::vector<unsigned char> inside;      // scratch, one flag per sphere
+};
+
+#endif
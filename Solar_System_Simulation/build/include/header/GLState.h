@@ -0,0 +1,93 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <map>
+
+// Texture units and capabilities whose state is remembered, others always reach GL
+const unsigned int GL_STATE_TEXTURE_UNITS = 32;
+const unsigned int GL_STATE_CAPABILITIES = 4;       // blend, depth test, program point size, rasterizer discard
+
+// Calls per frame that changed GL state and calls dropped because nothing would change,
+// and the draw calls made in between
+struct GLStateCounters
+{
+    unsigned int issued;
+    unsigned int skipped;
+    unsigned int draws;
+    unsigned int triangles;     // lines and points count none
+};
+
+// Thin cache in front of the GL state the render loop changes for every body: the program,
+// the vertex array, texture bindings, the enabled capabilities, depth and color masks and
+// the blend function. A call that would leave the state as it is never reaches GL. Every
+// module changes this state through glState, otherwise the cache would no longer match GL;
+// objects are deleted through it too, GL rebinds 0 when a bound object goes and its name can
+// be handed out again.
+class GLStateCache
+{
+public:
+    GLStateCache();
+
+    void useProgram(unsigned int program);
+    void bindVertexArray(unsigned int vertexArray);
+    // textureUnit is GL_TEXTUREi, as kept by Sphere and Annulus
+    void bindTexture(int textureUnit, GLenum target, unsigned int texture);
+    void enable(GLenum capability)              { setCapability(capability, true); }
+    void disable(GLenum capability)             { setCapability(capability, false); }
+    void depthMask(bool write);
+    void colorMask(bool write);
+    void blendFunc(GLenum source, GLenum destination);
+
+    void deleteProgram(unsigned int program);
+    void deleteVertexArray(unsigned int vertexArray);
+    void deleteTexture(unsigned int texture);
+    void deleteBuffer(unsigned int buffer);
+
+    // GPU memory: buffer data goes through here, texture sizes are reported after the upload
+    void bufferData(unsigned int buffer, GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void textureStorage(unsigned int texture, std::size_t bytes);   // mipmaps included
+    std::size_t getBufferBytes() const          { return bufferBytes; }
+    std::size_t getTextureBytes() const         { return textureBytes; }
+
+    // forget everything, the next call of each kind is issued, for code that went around the cache
+    void invalidate();
+
+    // tally a draw call right after making it, count vertices or indices per instance
+    void countDraw(GLenum mode, unsigned int count, unsigned int instances = 1);
+
+    // start counting a new frame, the finished frame's counters stay readable
+    void beginFrame();
+    const GLStateCounters& getFrameCounters() const     { return frame; }
+    const GLStateCounters& getLastFrameCounters() const { return lastFrame; }
+
+private:
+    GLStateCache(const GLStateCache&);
+    GLStateCache& operator=(const GLStateCache&);
+
+    void setCapability(GLenum capability, bool enabled);
+    void activeTexture(unsigned int unit);
+    bool changes(int& cached, int value);               // counts the call, true when GL needs it
+
+    // -1 is unknown, anything set to it is issued next time
+    int program;
+    int vertexArray;
+    int activeUnit;
+    int textures2D[GL_STATE_TEXTURE_UNITS];
+    int textureBuffers[GL_STATE_TEXTURE_UNITS];
+    int capabilities[GL_STATE_CAPABILITIES];
+    int depthWrite, colorWrite;
+    int blendSource, blendDestination;
+
+    GLStateCounters frame, lastFrame;
+
+    std::map<unsigned int, std::size_t> bufferSizes, textureSizes;
+    std::size_t bufferBytes, textureBytes;
+};
+
+// The GL state of the one context the application renders with
+extern GLStateCache glState;
+
+#endif
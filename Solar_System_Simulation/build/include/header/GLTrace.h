@@ -0,0 +1,70 @@
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#ifdef SOLAR_GL_TRACE
+#include <thread>
+#include <vector>
+#endif
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int GL_TRACE_SUMMARY_FUNCTIONS = 24;     // busiest functions listed by printSummary
+
+#ifdef SOLAR_GL_TRACE
+// Calls of one GL function, frames are counted between beginFrame and endFrame
+struct GLCallStats
+{
+    const char* name;
+    unsigned long long calls;           // inside frames
+    unsigned long long setupCalls;      // outside frames, loading and cleanup
+    unsigned int frameCalls;            // in the current frame
+    unsigned int maxFrameCalls;
+    double ms;                          // time spent in the driver, only for the timed functions
+    unsigned int errors;                // calls that left a GL error behind
+    bool timed;
+    bool creates;                       // makes a GL object
+    bool flagged;                       // creation inside a frame was reported
+};
+#endif
+
+// Instrumented build of the GL calls. Defining SOLAR_GL_TRACE makes install swap glad's
+// function pointers for wrappers that count the calls of each function per frame, time the
+// ones that are expensive in the driver (uploads, shader compilation, uniform lookups,
+// readback), check glGetError after every call and report objects created inside the frame
+// loop once the first frame is done. Only the thread that installed the wrappers is traced,
+// calls of a loader thread on its shared context go through uncounted. Frame times of this
+// build are not representative.
+// Without SOLAR_GL_TRACE every member is empty and GL calls go straight to the driver.
+class GLCallTracer
+{
+public:
+#ifdef SOLAR_GL_TRACE
+    GLCallTracer();
+
+    void install();                     // after every gladLoadGLLoader, which puts the driver's functions back
+    void beginFrame();
+    void endFrame();
+    void printSummary() const;
+
+    // called by the wrappers
+    bool isTracedThread() const                 { return std::this_thread::get_id() == owner; }
+    void recordCall(int function);
+    void recordTime(int function, double ms)    { stats[function].ms += ms; }
+    void recordError(int function, unsigned int error);
+
+private:
+    std::vector<GLCallStats> stats;
+    unsigned int frames;
+    bool inFrame;
+    std::thread::id owner;              // the render thread
+#else
+    void install()                      {}
+    void beginFrame()                   {}
+    void endFrame()                     {}
+    void printSummary() const           {}
+#endif
+};
+
+// The wrappers of the one GL context the application renders with
+extern GLCallTracer glTrace;
+
+#endif
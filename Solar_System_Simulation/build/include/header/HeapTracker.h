@@ -0,0 +1,88 @@
+#ifndef HEAP_TRACKER_H
+#define HEAP_TRACKER_H
+
+#include <header/Profiler.h>
+
+#include <cstddef>
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int HEAP_WARMUP_FRAMES = 10;         // first frames may allocate, lazy objects and caches fill up
+const unsigned int HEAP_MAX_SITES = 256;            // call sites kept, allocations at later ones are only counted
+const unsigned int HEAP_SITE_DEPTH = 10;            // return addresses taken at each allocation
+const unsigned int HEAP_SUMMARY_SITES = 12;         // busiest sites listed by printSummary
+
+// Allocations of the render thread in one profiler stage, over the steady frames
+struct HeapTagCounters
+{
+    unsigned long long allocations;
+    unsigned long long bytes;
+};
+
+// One place in the code that allocates in steady frames
+struct HeapSite
+{
+    void* stack[HEAP_SITE_DEPTH];
+    unsigned int depth;                 // 0 for a free slot
+    int tag;                            // profiler stage of the first allocation
+    bool driver;                        // made by a library on its own, the GL driver compiling a shader say
+    unsigned long long allocations;
+    unsigned long long bytes;
+};
+
+// Heap use of the program through replaced global operator new and delete. Every block
+// carries its size in front so frees are counted in bytes too. Allocations made by the render
+// thread between beginFrame and endFrame are counted per frame and per profiler stage, the
+// stage being the innermost ProfileScope; after the warm-up frames they should not happen at
+// all, and each one has its call stack taken so the summary can name the busiest sites.
+// Allocations that a library makes on its own, like a software renderer compiling a shader
+// variant, are the driver's and reported apart.
+class HeapTracker
+{
+public:
+    HeapTracker();
+
+    void reset();                       // forgets the frames and sites, the totals go on
+    void beginFrame();                  // on the render thread
+    void endFrame();
+
+    // innermost stage of the calling thread, returns the one it replaces
+    int setTag(int tag);
+
+    // frames after the warm-up where the application allocated, the test mode fails on any
+    unsigned int getSteadyFramesAllocating() const  { return steadyAllocatingFrames; }
+    unsigned int getLastFrameAllocations() const   { return lastFrameAllocations; }
+    static unsigned long long getTotalAllocations();
+    static long long getLiveBytes();
+    void printSummary() const;
+
+    // called by operator new and delete, caller is the return address of operator new
+    void recordFrameAllocation(std::size_t bytes, void* caller);
+    void recordFrameFree(std::size_t bytes);
+
+private:
+    HeapTracker(const HeapTracker&);
+    HeapTracker& operator=(const HeapTracker&);
+
+    bool recordSite(std::size_t bytes, int tag, void* caller);     // true for the driver
+
+    unsigned int frames;
+    unsigned int frameAllocations, frameFrees;
+    unsigned int frameApplicationAllocations;
+    std::size_t frameBytes;
+    unsigned int lastFrameAllocations;
+    unsigned int maxFrameAllocations, maxFrame;
+    unsigned int steadyAllocatingFrames;
+    unsigned long long steadyAllocations, steadyBytes;
+    unsigned long long steadyDriverAllocations;
+    unsigned long long frameTotalAllocations, frameTotalFrees;
+
+    HeapTagCounters tags[PROFILE_STAGE_COUNT];
+    HeapSite sites[HEAP_MAX_SITES];
+    unsigned int siteCount;
+    unsigned long long unsitedAllocations;  // steady allocations when the site table was full
+};
+
+// The heap of the process
+extern HeapTracker heapTracker;
+
+#endif
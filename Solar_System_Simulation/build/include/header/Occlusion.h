@@ -0,0 +1,66 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <header/shader_m.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Occlusion culling of the bodies with one GL query per body and temporal reuse.
+// A body that was visible is drawn inside a query, which costs nothing extra. A body that
+// was hidden only draws a depth-tested proxy quad inside a query, and its real draws are
+// wrapped in conditional rendering on that query, so the GPU skips their shading when the
+// proxy was hidden. Results are only read once available, never waited for; until then the
+// body keeps the status of its last finished query.
+class OcclusionCuller
+{
+public:
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    void resize(unsigned int count);            // needs the GL context
+    void destroy();
+
+    // read back finished queries and set the proxy camera
+    void beginFrame(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& eye);
+
+    // wrap every draw of a body (sphere, rings) between these two calls
+    void beginBody(int body, const glm::vec3& center, float radius);
+    void endBody(int body);
+
+    // wrap later draws of a body in the same frame, such as the transparent ring pass, between
+    // resumeBody and endBody; they are skipped along with the body's other draws
+    void resumeBody(int body);
+
+    // a body outside the frustum is drawn normally once it comes back
+    void reset(int body);
+
+    unsigned int getIssued() const              { return issued; }      // queries issued this frame
+    unsigned int getOccluded() const            { return occluded; }    // bodies hidden by their last finished query
+
+private:
+    OcclusionCuller(const OcclusionCuller&);
+    OcclusionCuller& operator=(const OcclusionCuller&);
+
+    enum Mode { DRAW_PLAIN, DRAW_QUERIED, DRAW_CONDITIONAL };
+
+    struct BodyQuery
+    {
+        unsigned int query;
+        bool pending;       // issued and not read back yet
+        bool hidden;        // last finished query found no samples
+        Mode mode;          // how the draws being issued are wrapped
+        bool conditional;   // drawn conditionally this frame
+    };
+
+    void drawProxy(const glm::vec3& center, float radius);
+
+    std::vector<BodyQuery> bodies;
+    Shader* proxyShader;
+    unsigned int proxyVAO, proxyVBO;
+    glm::vec3 eye;
+    unsigned int issued, occluded;
+};
+
+#endif
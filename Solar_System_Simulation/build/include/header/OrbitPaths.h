@@ -0,0 +1,66 @@
+#ifndef ORBIT_PATHS_H
+#define ORBIT_PATHS_H
+
+#include <header/shader_m.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Points per orbit path, the loop is closed by repeating the first point
+const unsigned int ORBIT_SEGMENTS = 256;
+
+// Orbit paths of every body in one shared buffer, one closed polyline per orbit relative to
+// the orbit's parent. A path is regenerated and re-uploaded only when its shape changes, the
+// per-frame data is one small instance record per orbit (parent position, color, where the body
+// is), and all orbits are drawn with a single instanced call. Lines go through line.gs, which
+// expands them to a fixed width in pixels, and fade along the trail behind the body.
+class OrbitPaths
+{
+public:
+    OrbitPaths();
+    ~OrbitPaths();
+
+    bool create(unsigned int orbitCount);          // needs the GL context
+    void destroy();
+
+    // shape of an orbit, both return true when the path had to be regenerated
+    bool setCircle(int orbit, float radius);
+    // Keplerian orbit of an Ephemeris_Body over one period from epochDay, auScale scene units per AU
+    bool setKepler(int orbit, int ephemerisBody, double epochDay, double periodDays, float auScale);
+
+    // per frame: parent position relative to the camera, fraction of the period the body is at
+    // (the path starts at 0), color with its opacity, 0 hides the orbit
+    void setPlacement(int orbit, const glm::vec3& parentCenter, float phase, const glm::vec4& color);
+
+    void draw(const glm::mat4& projection, const glm::mat4& view, const glm::vec2& viewport, float lineWidth);
+
+    unsigned int getCount() const               { return (unsigned int)paths.size(); }
+    unsigned int getUploads() const             { return uploads; }     // paths regenerated so far
+
+private:
+    OrbitPaths(const OrbitPaths&);
+    OrbitPaths& operator=(const OrbitPaths&);
+
+    // what a path was generated from, to know when it changes
+    struct PathKey
+    {
+        int kind;               // PATH_NONE, PATH_CIRCLE or PATH_KEPLER
+        int ephemerisBody;
+        double epochDay;
+        double periodDays;
+        float size;             // radius or AU scale
+    };
+
+    bool upload(int orbit, const PathKey& key);
+
+    Shader* shader;
+    std::vector<PathKey> paths;
+    std::vector<float> points;          // vec4 per point: xyz, w fraction of the period
+    std::vector<float> instances;       // per orbit: center xyz, phase, color rgba
+    unsigned int pointBuffer, pointTexture;
+    unsigned int instanceBuffer, vertexArray;
+    unsigned int uploads;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <header/shader_m.h>
+
+#include <vector>
+
+// Vertex of the overlay, pixels from the top left corner
+struct OverlayVertex
+{
+    float x, y;
+    float u, v;                 // in the glyph atlas
+    unsigned char color[4];     // RGBA
+};
+
+// Performance panel in the corner of the frame: a graph of the last frame times, FPS, CPU
+// and GPU time, simulation step time, draw calls, triangles, state changes and texture and
+// buffer memory. Everything comes from the profiler and the GL state cache. Text and bars are
+// quads in one vertex buffer drawn with a single call, the glyphs come from a tiny built-in
+// 5x7 font; the overlay times itself as a profiler stage.
+class PerformanceOverlay
+{
+public:
+    PerformanceOverlay();
+    ~PerformanceOverlay();
+
+    void draw(unsigned int width, unsigned int height);     // creates its GL objects the first time
+    void destroy();
+
+    void setVisible(bool visible)               { this->visible = visible; }
+    bool isVisible() const                      { return visible; }
+
+private:
+    PerformanceOverlay(const PerformanceOverlay&);
+    PerformanceOverlay& operator=(const PerformanceOverlay&);
+
+    void create();
+    void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned int color);
+    void addRect(float x0, float y0, float x1, float y1, unsigned int color);
+    void addText(float x, float y, const char* text, unsigned int color);
+
+    Shader* shader;
+    unsigned int vertexArray, vertexBuffer, indexBuffer, atlas;
+    std::vector<OverlayVertex> vertices;        // rebuilt every frame, capacity kept
+    bool visible;
+};
+
+#endif
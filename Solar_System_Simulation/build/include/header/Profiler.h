@@ -0,0 +1,154 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Stages of a frame in the render loops, several scopes of one stage in a frame add up
+enum ProfileStage
+{
+    PROFILE_FRAME,              // from the start of the loop body to the end of the swap
+    PROFILE_INPUT,              // processInput
+    PROFILE_SIMULATION,         // asteroid belt and orbit path updates
+    PROFILE_MATRICES,           // body model matrices
+    PROFILE_CULLING,            // frustum and occlusion setup, sorting the visible bodies
+    PROFILE_STARS,              // draws of each pass
+    PROFILE_BODIES,
+    PROFILE_BELT,
+    PROFILE_ORBITS,
+    PROFILE_RINGS,
+    PROFILE_OVERLAY,            // performance overlay
+    PROFILE_CAPTURE,            // readback of a recorded frame
+    PROFILE_SWAP,               // swap and poll, or finish and capture offscreen
+    PROFILE_STAGE_COUNT
+};
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int PROFILER_QUERY_BUFFERS = 2;      // frames of timer queries, one is read while the other records
+const unsigned int PROFILER_MAX_SCOPES = 32;        // scopes per frame, later ones are not timed
+const unsigned int PROFILER_HISTORY = 240;          // frames in the rolling histograms
+const unsigned int PROFILER_BUCKETS = 16;           // powers of two from 1 us, the last one is open
+const unsigned int PROFILER_TRACE_EVENTS = 16384;   // scopes kept for the trace, the oldest are dropped
+const char* const PROFILER_TRACE_FILE = "solar_trace.json";
+
+// Milliseconds per frame of one stage over the last PROFILER_HISTORY frames
+class ProfileHistogram
+{
+public:
+    ProfileHistogram();
+
+    void add(float ms);
+    void clear();
+
+    unsigned int getCount() const               { return count; }
+    unsigned int getBucket(unsigned int i) const    { return buckets[i]; }
+    float getLatest() const                     { return getSample(0); }
+    // frames back from the latest, 0 past the oldest
+    float getSample(unsigned int age) const     { return age < count ? samples[(next + PROFILER_HISTORY - 1 - age) % PROFILER_HISTORY] : 0.0f; }
+    float getMean() const                       { return count ? (float)(total / count) : 0.0f; }
+    float getPercentile(float fraction) const;  // nearest rank, 0.5 is the median
+    float getMax() const;
+
+    // upper end of a bucket in milliseconds, infinite for the last
+    static float bucketLimit(unsigned int i);
+
+private:
+    static unsigned int bucketOf(float ms);
+
+    float samples[PROFILER_HISTORY];            // ring
+    unsigned int buckets[PROFILER_BUCKETS];
+    unsigned int count, next;
+    double total;
+};
+
+// One timed scope, microseconds since the profiler started, GPU times on the CPU clock
+struct ProfileEvent
+{
+    uint32_t frame;
+    uint32_t stage;
+    double cpuStart, cpuEnd;
+    double gpuStart, gpuEnd;                    // negative when the GPU times were not available
+};
+
+// CPU and GPU timing of the stages of each frame. Every scope takes the CPU clock and puts
+// a GL_TIMESTAMP query in the command stream at both ends. The queries of a frame are read
+// at the end of the next one, when the GPU is usually done with them, so the render loop
+// never waits; results that are still not there are dropped. Stage times go into rolling
+// histograms, and the last scopes are kept for a trace that chrome://tracing and Perfetto
+// open, CPU and GPU as two threads.
+class FrameProfiler
+{
+public:
+    FrameProfiler();
+    ~FrameProfiler();
+
+    void beginFrame();                          // needs the GL context, creates the queries the first time
+    void endFrame();                            // after the swap
+    void destroy();                             // before the context goes, forgets everything measured
+
+    // scope index for end, negative when it is not timed
+    int begin(ProfileStage stage);
+    void end(int scope);
+
+    const ProfileHistogram& getCpuHistogram(int stage) const    { return cpuHistograms[stage]; }
+    const ProfileHistogram& getGpuHistogram(int stage) const    { return gpuHistograms[stage]; }
+    unsigned int getDroppedFrames() const       { return dropped; }     // GPU results not ready in time
+    static const char* stageName(int stage);
+
+    // reads every outstanding query first, waiting for them
+    bool writeTrace(const char* path);
+    void printSummary() const;
+
+private:
+    FrameProfiler(const FrameProfiler&);
+    FrameProfiler& operator=(const FrameProfiler&);
+
+    struct FrameQueries
+    {
+        unsigned int queries[PROFILER_MAX_SCOPES * 2];
+        ProfileEvent events[PROFILER_MAX_SCOPES];
+        unsigned int count;
+        bool pending;                           // recorded and not read back yet
+    };
+
+    double now() const;
+    void resolve(FrameQueries& slot, bool wait);
+
+    FrameQueries slots[PROFILER_QUERY_BUFFERS];
+    FrameQueries* current;                      // NULL outside beginFrame and endFrame
+    bool created;
+    uint32_t frame;
+    int frameScope;
+    unsigned int dropped;
+
+    std::chrono::steady_clock::time_point cpuEpoch;
+    GLint64 gpuEpoch;                           // GPU timestamp at cpuEpoch, ns
+
+    ProfileHistogram cpuHistograms[PROFILE_STAGE_COUNT];
+    ProfileHistogram gpuHistograms[PROFILE_STAGE_COUNT];
+    std::vector<ProfileEvent> trace;            // ring of PROFILER_TRACE_EVENTS
+    std::size_t traceNext, traceCount;
+};
+
+// Times a stage until the end of the block, heap allocations in it are put on the stage
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileStage stage);
+    ~ProfileScope();
+
+private:
+    ProfileScope(const ProfileScope&);
+    ProfileScope& operator=(const ProfileScope&);
+
+    int scope;
+    int heapTag;                                // stage of the enclosing scope
+};
+
+// The profiler of the render loops
+extern FrameProfiler profiler;
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum RecordFormat
+{
+    RECORD_Y4M,                 // YUV4MPEG2 4:2:0 video, ffmpeg and most players read it
+    RECORD_RAW,                 // bare RGB24 frames, ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH
+    RECORD_PNG                  // one file per frame from a printf pattern, uncompressed deflate
+};
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int RECORDER_PIXEL_BUFFERS = 3;      // readbacks in flight, the oldest is usually done when its slot comes round
+const unsigned int RECORDER_QUEUE = 8;              // frames copied out and waiting for the encoder
+const char* const RECORDER_WINDOW_FILE = "solar_demo.y4m";
+const char* const RECORDER_WINDOW_PART_FILE = "solar_demo_%u.y4m";    // next parts, after the window was resized while recording
+const double RECORDER_WINDOW_FPS = 60.0;            // nominal rate of window recordings, frames come as they are drawn
+
+// Records the frames of the render loop without stalling it. Each frame is read into the next
+// of a ring of pixel buffer objects with a fence behind it, so glReadPixels returns at once;
+// buffers whose fence has passed are copied into one of a fixed set of frame buffers and
+// handed to an encoder thread that converts and writes them. Nothing is allocated while
+// recording. When the encoder falls behind the render loop either waits for it (offscreen,
+// every frame is kept) or drops the frame (window, the frame rate is kept).
+class FrameRecorder
+{
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    // path ends in .y4m or .rgb, or is a pattern with one integer conversion for PNG files;
+    // needs the context, false with a message when the path is not usable
+    bool start(const char* path, unsigned int width, unsigned int height, double fps, bool dropWhenBehind);
+    void capture();                                 // after the frame is drawn, before the swap
+    void stop();                                    // writes every frame still in flight, prints the report
+
+    bool isRecording() const                    { return recording; }
+    unsigned int getDropped() const             { return dropped; }
+    unsigned int getQueueDepth();                   // frames waiting for the encoder
+
+private:
+    FrameRecorder(const FrameRecorder&);
+    FrameRecorder& operator=(const FrameRecorder&);
+
+    struct PixelBuffer
+    {
+        unsigned int buffer;
+        GLsync fence;                               // NULL when the buffer is free
+        unsigned int frame;
+    };
+
+    void collect(PixelBuffer& pixels, bool wait);   // hands a finished readback to the encoder
+    void encode();                                  // encoder thread
+    bool writeFrame(const unsigned char* rgba, unsigned int frame);
+    bool writeY4M(const unsigned char* rgba);
+    bool writeRaw(const unsigned char* rgba);
+    bool writePNG(const unsigned char* rgba, unsigned int frame);
+
+    bool recording;
+    int format;                                     // RecordFormat
+    std::string path;
+    FILE* file;                                     // video formats, PNG files are opened per frame
+    unsigned int width, height;
+    bool dropWhenBehind;
+
+    PixelBuffer pixelBuffers[RECORDER_PIXEL_BUFFERS];
+    unsigned int nextPixelBuffer;
+
+    // frame buffers go from free to queued and back, all under the mutex
+    std::vector<unsigned char> frames[RECORDER_QUEUE];  // RGBA rows bottom up, as GL reads them
+    unsigned int frameNumbers[RECORDER_QUEUE];
+    unsigned int queued[RECORDER_QUEUE];            // ring of frame buffers waiting
+    unsigned int queueHead, queueCount;
+    unsigned int freeFrames[RECORDER_QUEUE];
+    unsigned int freeCount;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable frameQueued, frameFreed;
+    std::thread encoder;
+    std::vector<unsigned char> scratch;             // encoder's converted frame
+
+    // report
+    unsigned int captured, written, dropped, failed;
+    unsigned int maxQueueDepth;
+    unsigned long long queueDepthTotal;
+    double encodeMs;
+};
+
+// Recording of the render loops, headless --record or F8 in the window
+extern FrameRecorder frameRecorder;
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class CameraPath;
+
+enum BackendType
+{
+    BACKEND_WINDOW,             // GLFW window, live input, runs until closed
+    BACKEND_OFFSCREEN           // framebuffer object without a display, fixed number of frames
+};
+
+// Cost of one offscreen frame
+struct FrameStats
+{
+    float cpuMs;                // from beginFrame until every GL call of the frame is made
+    float frameMs;              // until the GPU finished the frame
+    float gpuMs;                // between timestamps at both ends of the frame, 0 without timer queries
+    unsigned int drawCalls;
+    unsigned int triangles;
+    unsigned int stateChanges;  // calls the state cache let through
+};
+
+// Every frame of an offscreen run, kept after the render loop returns
+struct FrameLog
+{
+    std::string renderer;       // GL_RENDERER of the context
+    std::vector<FrameStats> frames;
+};
+
+// How the render loop gets its context and where its frames go
+struct BackendOptions
+{
+    int type;                   // BackendType
+    unsigned int frames;        // offscreen: frames drawn before the loop ends
+    double frameTime;           // offscreen: simulated seconds per frame, the clock does not follow the wall
+    const char* capturePath;    // offscreen: the last frame is written there as a binary PPM, NULL for none
+    const CameraPath* cameraPath;   // offscreen: moves the camera at the start of each frame, NULL leaves it alone
+    FrameLog* log;              // offscreen: receives the renderer and the stats of every frame, NULL for none
+    const char* tracePath;      // the profiler's trace is written there when the backend is destroyed, NULL for none
+    bool overlay;               // draw the performance overlay from the first frame, F3 toggles it in the window
+    const char* recordPath;     // offscreen: every frame is recorded there (see FrameRecorder), NULL for none
+    unsigned int width, height; // size of the framebuffer, 0 for the size the render loop asks for
+
+    BackendOptions();           // window
+};
+
+// Context and default framebuffer of the render loops. The window backend is the GLFW window of
+// the interactive versions. The offscreen backend creates a context without a display, through
+// EGL (surfaceless Mesa, llvmpipe included) when built with SOLAR_EGL or a hidden GLFW window
+// otherwise, and binds a framebuffer object of the window's size, so the same render path runs
+// on build servers. Each offscreen frame is finished before the next starts and timed, the
+// simulated time advances by a fixed step so every run draws the same frames.
+// Built with SOLAR_NO_WINDOW, without GLFW, only the offscreen backend through EGL exists.
+// Either backend can add a loader context sharing its objects, for a thread that compiles
+// shaders while the render thread goes on (see ShaderVariants).
+class RenderBackend
+{
+public:
+    RenderBackend();
+    ~RenderBackend();
+
+    // create the context, load GL and set up the framebuffer, false with a message on failure
+    bool create(const BackendOptions& options, unsigned int width, unsigned int height, const char* title);
+    void destroy();                                 // after every GL object is deleted, and the loader thread ended
+
+    // second context sharing the objects of the first, created on the render thread and made
+    // current on the loader thread; a hidden 1x1 window with GLFW, false when none can be made
+    bool createLoaderContext();
+    bool makeLoaderContextCurrent();                // on the loader thread
+    void releaseLoaderContext();                    // on the loader thread, before it ends
+
+    bool beginFrame();                              // false when the window closed or all frames are drawn
+    void endFrame();                                // swap and poll, or finish, time and capture
+                                                    // the profiler's frames start and end with these
+    double getTime() const;                         // seconds, wall clock or frame count times the step
+
+    GLFWwindow* getWindow() const               { return window; }     // NULL offscreen
+    bool isOffscreen() const                    { return options.type == BACKEND_OFFSCREEN; }
+    unsigned int getFrame() const               { return frame; }      // frames ended so far
+    const std::vector<FrameStats>& getFrameStats() const    { return frameStats; }  // per offscreen frame
+
+    // pixels of the last frame, RGB rows from top to bottom
+    bool readFrame(std::vector<unsigned char>& pixels) const;
+    bool writeFrame(const char* path) const;
+    void printFrameTimes() const;
+
+private:
+    RenderBackend(const RenderBackend&);
+    RenderBackend& operator=(const RenderBackend&);
+
+    bool createWindow(bool visible, const char* title);
+    bool createDisplayless(const char* title);
+    bool createFramebuffer();
+    void finishFrame();
+
+    BackendOptions options;
+    unsigned int width, height;
+    GLFWwindow* window;
+    void* display;                  // EGLDisplay, EGLConfig and EGLContext, kept out of this header
+    void* config;
+    void* context;
+    void* loaderContext;            // EGLContext, or the GLFWwindow of the loader context
+    unsigned int framebuffer, colorBuffer, depthBuffer;
+    unsigned int frame;
+    unsigned int timeQueries[2];    // GL_TIMESTAMP at the start and the end of the frame
+    std::chrono::steady_clock::time_point frameStart;
+    std::vector<FrameStats> frameStats;
+};
+
+// draw one of the versions offscreen, options after --headless on the command line
+int runHeadless(int argc, char** argv);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// constants //////////////////////////////////////////////////////////////////
+const char* const SHADER_CACHE_FILE = "solar_shaders.cache";             // in the working directory, next to the shaders
+const char* const SHADER_CACHE_ENVIRONMENT = "SOLAR_SHADER_CACHE";      // environment variable with another path for the file
+const uint64_t SHADER_CACHE_SEED = 14695981039346656037ULL;    // key of a program before any source, FNV-1a offset basis
+const unsigned int SHADER_CACHE_MAX_PROGRAMS = 64;              // programs not used by a run are dropped beyond this
+
+// Linked programs kept across runs with glGetProgramBinary, so a launch links them from the
+// driver's binaries with glProgramBinary instead of compiling their sources again. A program is
+// keyed by the hash of its sources, the cache file holds the binaries of one driver: GL vendor,
+// renderer and version must match or the file is ignored and replaced. A binary the driver
+// refuses, after an update that kept its strings, is compiled from source again like a miss.
+// The file is SHADER_CACHE_FILE in the working directory unless SOLAR_SHADER_CACHE names another.
+// Programs may be built on a loader thread with a shared context (see ShaderVariants), every
+// member but hash and prepare locks the cache.
+class ShaderCache
+{
+public:
+    ShaderCache();
+
+    // key of a program: chain one call per source or other input of the link, from SHADER_CACHE_SEED
+    static uint64_t hash(uint64_t key, const char* text);
+
+    // link program from the binary cached under key, false when there is none or it is refused;
+    // needs the context, the cache file is read on the first call
+    bool load(unsigned int program, uint64_t key);
+    // before linking from source: the driver is asked to keep the binary retrievable
+    void prepare(unsigned int program);
+    // after linking from source, keeps the binary when the link succeeded
+    void store(unsigned int program, uint64_t key, double compileMs);
+    // writes the cache file when programs were added, the context may be gone
+    void save();
+
+    // programs linked from binaries and compiled since the last summary, with their time
+    void printSummary();
+
+private:
+    ShaderCache(const ShaderCache&);
+    ShaderCache& operator=(const ShaderCache&);
+
+    struct ProgramBinary
+    {
+        GLenum format;
+        bool used;                      // loaded or stored by this run
+        std::vector<unsigned char> data;
+    };
+
+    bool open();                        // false when the context cannot hand out binaries
+    void read();
+
+    std::mutex mutex;
+    std::string path;                   // of the cache file
+    bool fileRead;
+    bool changed;                       // programs stored since the file was read or written
+    std::string driver;                 // vendor, renderer and version of the cached binaries
+    std::map<uint64_t, ProgramBinary> programs;
+
+    // since the last summary
+    unsigned int loaded, compiled, refused;
+    double loadMs, compileMs;
+    bool unsupported;
+};
+
+// Program binaries of every Shader
+extern ShaderCache shaderCache;
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class RenderBackend;
+class Shader;
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int SHADER_MAX_FEATURES = 6;         // a variant is indexed by the bit mask of its features
+
+// Specialized programs of one vertex and fragment source. Every feature is a define the sources
+// test with #ifdef, a variant is a set of features as a bit mask in the order of their names, and
+// is compiled with those defines so the code of the other features is not in it at all. Each one
+// is compiled once, when first requested: request hands it to a loader thread that compiles on a
+// context sharing objects with the render context, so the render thread goes on meanwhile, and
+// get returns it, waiting only when it is still being compiled. Variants never requested, or all
+// of them when the backend has no loader context, are compiled by get on the calling thread.
+class ShaderVariants
+{
+public:
+    ShaderVariants();
+    ~ShaderVariants();
+
+    // the names must outlive the variants, backend NULL compiles every variant in get
+    void create(const char* vertexPath, const char* fragmentPath, const char* const* featureNames, unsigned int featureCount,
+        RenderBackend* backend);
+    void destroy();                                 // ends the loader thread and deletes the programs, before the backend
+
+    void request(unsigned int features);            // compiled in the background from now on
+    Shader& get(unsigned int features);             // on the render thread
+
+    // where the variants were compiled and how long the render thread waited for them
+    void printSummary();
+
+private:
+    ShaderVariants(const ShaderVariants&);
+    ShaderVariants& operator=(const ShaderVariants&);
+
+    void load();                                    // loader thread
+    Shader* compile(unsigned int features) const;
+
+    std::string vertexPath, fragmentPath;
+    const char* const* featureNames;
+    unsigned int featureCount;
+    RenderBackend* backend;
+
+    // variants go from requested to queued to compiled, all under the mutex
+    Shader* variants[1 << SHADER_MAX_FEATURES];
+    bool requested[1 << SHADER_MAX_FEATURES];
+    unsigned int queued[1 << SHADER_MAX_FEATURES];  // ring of variants waiting for the loader thread
+    unsigned int queueHead, queueCount;
+    bool loading;                                   // the loader thread has its context
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable variantQueued, variantCompiled;
+    std::thread loader;
+
+    // report
+    unsigned int compiledInBackground, compiledInPlace, waits;
+    double waitMs;
+};
+
+#endif
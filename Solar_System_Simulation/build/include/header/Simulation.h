@@ -0,0 +1,96 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <header/Ephemeris.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CheckpointWriter;
+
+// Bodies integrated by the n-body simulation: the sun followed by the planets in ephemeris order
+const int SIM_SUN = 0;
+const int SIM_BODY_COUNT = EPH_BODY_COUNT + 1;
+
+// One what-if run, usually read from a scenario file line such as
+//   name=heavy_jupiter start=2000 years=100 step=1 mass.jupiter=2 kick.earth=0.0001,0,0
+struct ScenarioConfig
+{
+    std::string name;
+    double startYear;                       // calendar year of the initial state
+    double years;                           // simulated duration
+    double stepDays;                        // fixed integration step
+    double massScale[SIM_BODY_COUNT];       // multiplies the nominal mass of each body
+    double kick[SIM_BODY_COUNT][3];         // velocity change at start, AU/day
+
+    ScenarioConfig();
+};
+
+// Full integrator state, plain data so it can be copied and written as is
+struct SimulationState
+{
+    double day;                             // days since J2000
+    uint64_t step;
+    double stepDays;
+    double gm[SIM_BODY_COUNT];              // AU^3/day^2
+    double position[SIM_BODY_COUNT][3];     // barycentric, AU
+    double velocity[SIM_BODY_COUNT][3];     // AU/day
+};
+
+// Fixed-step leapfrog n-body integration of the sun and planets. Uses no GL and
+// no heap memory, so one instance per worker is all a scenario needs.
+class Simulation
+{
+public:
+    Simulation();
+
+    void reset(const ScenarioConfig& config);
+    void step();
+    void run(uint64_t steps);
+
+    double energy() const;
+    glm::dvec3 heliocentric(int body) const;
+
+    const SimulationState& getState() const     { return state; }
+    void setState(const SimulationState& s);
+
+private:
+    void computeAccelerations();
+
+    SimulationState state;
+    double acceleration[SIM_BODY_COUNT][3];
+};
+
+// Summary of one scenario
+struct ScenarioResult
+{
+    std::string name;
+    uint64_t steps;
+    double seconds;
+    double energyError;                     // relative drift of the total energy
+    double keplerDeviation[EPH_BODY_COUNT]; // final distance from the unperturbed Keplerian position, AU
+    double minDistance[EPH_BODY_COUNT];     // heliocentric, AU
+    double maxDistance[EPH_BODY_COUNT];
+    std::size_t memoryBytes;                // working memory of the scenario
+    bool ok;
+};
+
+// parse a scenario file, one scenario per line, '#' starts a comment
+bool loadScenarios(const char* path, std::vector<ScenarioConfig>& scenarios);
+
+// run one scenario to completion, queuing a checkpoint to <checkpointDir>/<name>.chk
+// every checkpointEvery steps when a writer is given
+ScenarioResult runScenario(const ScenarioConfig& config, CheckpointWriter* checkpoints = NULL,
+    uint64_t checkpointEvery = 0, const std::string& checkpointDir = ".");
+
+// run every scenario on a pool of worker threads (0 = one per core) and write a CSV summary
+int runScenarios(const std::vector<ScenarioConfig>& scenarios, int threads, const char* outputPath,
+    uint64_t checkpointEvery = 0, const std::string& checkpointDir = ".");
+
+// command line entry point:
+//   --batch <scenario file> [--threads N] [--output file] [--checkpoint-every N] [--checkpoint-dir dir]
+int runBatch(int argc, char** argv);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#include <cmath>
+#include <cstdint>
+
+// Default clock values
+const double TICK_SECONDS = 1.0 / 240.0;
+const uint64_t MAX_TICKS_PER_FRAME = 240;
+
+// Plain clock data, stored in checkpoints
+struct SimulationClockState
+{
+    uint64_t tick;
+    double tickSeconds;
+    double timeScale;
+    double accumulator;     // real seconds not yet turned into a tick
+    uint32_t paused;
+    uint32_t reserved;
+};
+
+// Fixed-step simulation clock. Time only advances in whole ticks and is computed as
+// tick * tickSeconds, never accumulated, so a clock restored from a checkpoint gives
+// bit-identical times no matter the frame rate of the run that replays it.
+class SimulationClock
+{
+public:
+    SimulationClock(double tickSeconds = TICK_SECONDS)
+    {
+        state.tick = 0;
+        state.tickSeconds = tickSeconds;
+        state.timeScale = 1.0;
+        state.accumulator = 0.0;
+        state.paused = 0;
+        state.reserved = 0;
+    }
+
+    // turn real frame time into whole ticks, returns the number of ticks taken this frame
+    uint64_t advance(double realSeconds)
+    {
+        if (state.paused)
+            return 0;
+        state.accumulator += realSeconds * state.timeScale;
+        if (state.accumulator < 0.0)
+            state.accumulator = 0.0;
+        uint64_t ticks = (uint64_t)std::floor(state.accumulator / state.tickSeconds);
+        if (ticks > MAX_TICKS_PER_FRAME)
+        {
+            // drop the backlog after a stall instead of catching up forever
+            ticks = MAX_TICKS_PER_FRAME;
+            state.accumulator = 0.0;
+        }
+        else
+        {
+            state.accumulator -= ticks * state.tickSeconds;
+        }
+        state.tick += ticks;
+        return ticks;
+    }
+
+    double getTime() const                          { return state.tick * state.tickSeconds; }
+    uint64_t getTick() const                        { return state.tick; }
+    bool isPaused() const                           { return state.paused != 0; }
+    void setPaused(bool paused)                     { state.paused = paused ? 1 : 0; }
+    void setTimeScale(double timeScale)             { state.timeScale = timeScale; }
+
+    const SimulationClockState& getState() const    { return state; }
+    void setState(const SimulationClockState& s)    { state = s; }
+
+private:
+    SimulationClockState state;
+};
+
+#endif
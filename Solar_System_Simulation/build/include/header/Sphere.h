@@ -60,6 +60,13 @@ public:
     int getTextureGL() const                { return textureGL; }
     int getTexture() const                  { return texture; }
 
+    // GL objects of the uploaded mesh, 0 until uploaded, the index buffer holds the
+    // triangle indices followed by the line indices; upload again after changing the shape
+    void setBuffers(unsigned int vertexArray, unsigned int vertexBuffer, unsigned int indexBuffer);
+    unsigned int getVertexArray() const     { return vertexArray; }
+    unsigned int getVertexBuffer() const    { return vertexBuffer; }
+    unsigned int getIndexBuffer() const     { return indexBuffer; }
+
     // for interleaved vertices: V/N/T
     unsigned int getInterleavedVertexCount() const  { return getVertexCount(); }    // # of vertices
     unsigned int getInterleavedVertexSize() const   { return (unsigned int)interleavedVertices.size() * sizeof(float); }    // # of bytes
@@ -100,6 +107,7 @@ private:
     int textureInt;
     int textureGL;
     unsigned int texture;
+    unsigned int vertexArray, vertexBuffer, indexBuffer;
     std::vector<float> vertices;
     std::vector<float> normals;
     std::vector<float> texCoords;
@@ -0,0 +1,79 @@
+#ifndef STARFIELD_H
+#define STARFIELD_H
+
+#include <header/shader_m.h>
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Default star catalog looked up by both versions (build with --build-stars)
+const char* const STAR_CATALOG_FILE = "stars.cat";
+
+// On-disk layout, native endian: header | records[count]
+struct StarCatalogHeader
+{
+    char magic[8];              // "SOLARSTR"
+    uint32_t version;
+    uint32_t count;
+};
+
+// 16 bytes per star, uploaded as is
+struct StarRecord
+{
+    float direction[3];         // unit vector in scene axes (ecliptic x, z, -y)
+    uint8_t color[3];           // sRGB
+    uint8_t magnitude;          // visual magnitude, (V + 2) * 16, so -2 to 13.9
+};
+
+// Background stars drawn as point sprites in one call. The catalog is read on a background
+// thread in fixed-size chunks and each frame uploads the chunks that arrived into a buffer
+// sized for the whole catalog, so the window opens at once and the sky fills in while the
+// rest streams. The reader stops when a few chunks are waiting, which bounds the memory
+// used on the way to the GPU whatever the catalog size.
+class Starfield
+{
+public:
+    Starfield();
+    ~Starfield();
+
+    // read the header, allocate the GPU buffer and start streaming, needs the GL context
+    bool open(const char* path);
+    void destroy();
+
+    // upload what was read since the last frame, on the GL thread
+    void update();
+    void draw(const glm::mat4& projection, const glm::mat4& view);
+
+    unsigned int getCount() const               { return count; }
+    unsigned int getUploaded() const            { return uploaded; }    // stars drawable so far
+    bool isStreaming() const                    { return uploaded < count; }
+
+private:
+    Starfield(const Starfield&);
+    Starfield& operator=(const Starfield&);
+
+    void readChunks(FILE* file);
+
+    Shader* shader;
+    unsigned int vertexArray, vertexBuffer;
+    unsigned int count, uploaded;
+
+    std::thread reader;
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::deque<std::vector<StarRecord> > chunks;
+    bool stopping;
+};
+
+// write a synthetic catalog: stars crowding toward a galactic plane, magnitudes counted
+// like the real sky (about 3x more stars per magnitude), colors from a B-V index
+bool buildStarCatalog(const char* path, unsigned int count, unsigned int seed);
+
+#endif
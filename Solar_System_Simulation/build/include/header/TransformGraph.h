@@ -0,0 +1,42 @@
+#ifndef TRANSFORM_GRAPH_H
+#define TRANSFORM_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Flat transform hierarchy stored as parallel arrays. A node can only be added after its
+// parent, so parents always precede children and world matrices are composed in one
+// linear pass over the arrays. Only dirty nodes and their subtrees are recomputed.
+class TransformGraph
+{
+public:
+    TransformGraph() {}
+
+    void reserve(unsigned int count);
+    void clear();
+
+    // add a node under parent (-1 for a root), returns its index
+    int addNode(int parent, const glm::mat4& local = glm::mat4(1.0f));
+
+    // replace the local transform and mark the node dirty
+    void setLocal(int node, const glm::mat4& local);
+
+    // compose world matrices of dirty subtrees, returns the number of recomputed nodes
+    unsigned int update();
+
+    unsigned int getNodeCount() const               { return (unsigned int)parents.size(); }
+    int getParent(int node) const                   { return parents[node]; }
+    bool isDirty(int node) const                    { return dirty[node] != 0; }
+    const glm::mat4& getLocal(int node) const       { return locals[node]; }
+    const glm::mat4& getWorld(int node) const       { return worlds[node]; }
+    const glm::mat4* getWorldMatrices() const       { return worlds.data(); }
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<unsigned char> dirty;
+};
+
+#endif
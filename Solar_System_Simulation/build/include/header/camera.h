@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cmath>
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
     FORWARD,
@@ -22,13 +24,25 @@ const float SPEED = 20.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
 
+// Depth range. Depth is stored logarithmically (see logdepth.glsl), which keeps the same relative
+// precision at every distance, so one pass covers tens of meters up close (1e-9 scene units at
+// the scaled distance) to far beyond Neptune
+const float NEAR_PLANE = 1e-9f;
+const float FAR_PLANE = 1e4f;
+
+// logDepth uniform of the shaders: (near, 1 / log2(far / near))
+inline glm::vec2 LogDepthParameters()
+{
+    return glm::vec2(NEAR_PLANE, 1.0f / std::log2(FAR_PLANE / NEAR_PLANE));
+}
+
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
 class Camera
 {
 public:
-    // camera Attributes
-    glm::vec3 Position;
+    // camera Attributes, the position is double precision, see GetViewMatrix
+    glm::dvec3 Position;
     glm::vec3 Front;
     glm::vec3 Up;
     glm::vec3 Right;
@@ -42,7 +56,7 @@ public:
     float Zoom;
 
     // constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(glm::dvec3 position = glm::dvec3(0.0, 0.0, 0.0), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
         Position = position;
         WorldUp = up;
@@ -53,17 +67,32 @@ public:
     // constructor with scalar values
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
-        Position = glm::vec3(posX, posY, posZ);
+        Position = glm::dvec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
         Yaw = yaw;
         Pitch = pitch;
         updateCameraVectors();
     }
 
-    // returns the view matrix calculated using Euler Angles and the LookAt Matrix
+    // returns the view matrix calculated using Euler Angles and the LookAt Matrix, relative to the camera:
+    // it only rotates, the eye is at the origin. World positions are moved by -Position in double
+    // precision before they become floats (see RelativePosition), so nothing loses precision far from
+    // the world origin
     glm::mat4 GetViewMatrix()
     {
-        return glm::lookAt(Position, Position + Front, Up);
+        return glm::lookAt(glm::vec3(0.0f), Front, Up);
+    }
+
+    // a double-precision world position in the frame of GetViewMatrix
+    glm::vec3 RelativePosition(const glm::dvec3& position) const
+    {
+        return glm::vec3(position - Position);
+    }
+
+    // returns the projection matrix for the current zoom, the depth range is only used for clipping and culling
+    glm::mat4 GetProjectionMatrix(float aspect)
+    {
+        return glm::perspective(glm::radians(Zoom), aspect, NEAR_PLANE, FAR_PLANE);
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -71,17 +100,17 @@ public:
     {
         float velocity = MovementSpeed * deltaTime;
         if (direction == FORWARD)
-            Position += Front * velocity;
+            Position += glm::dvec3(Front * velocity);
         if (direction == BACKWARD)
-            Position -= Front * velocity;
+            Position -= glm::dvec3(Front * velocity);
         if (direction == LEFT)
-            Position -= Right * velocity;
+            Position -= glm::dvec3(Right * velocity);
         if (direction == RIGHT)
-            Position += Right * velocity;
+            Position += glm::dvec3(Right * velocity);
         if (direction == UP)
-            Position += Up * velocity;
+            Position += glm::dvec3(Up * velocity);
         if (direction == DOWN)
-            Position -= Up * velocity;
+            Position -= glm::dvec3(Up * velocity);
     }
 
     // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
@@ -3,51 +3,51 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <header/GLState.h>
+#include <header/ShaderCache.h>
 
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+// constants //////////////////////////////////////////////////////////////////
+const int SHADER_MAX_INCLUDE_DEPTH = 8;     // deeper #include chains are taken for a cycle
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly, the geometry shader is optional;
+    // defines is a space separated list of names, or NAME=value, defined in every stage
+    // right after #version, so one source can be compiled into specialized variants;
+    // a program linked from the same sources before comes from the binary cache
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = NULL, const char* defines = NULL)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
+        // 1. retrieve the vertex/fragment source code from filePath, with its includes and defines
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
+        std::string geometryCode;
+        readSource(vertexPath, defines, vertexCode);
+        readSource(fragmentPath, defines, fragmentCode);
+        // if geometry shader path is present, also load a geometry shader
+        if (geometryPath != NULL)
+            readSource(geometryPath, defines, geometryCode);
+        // 2. link the cached binary of the same sources when the driver kept one
+        ID = glCreateProgram();
+        uint64_t key = ShaderCache::hash(ShaderCache::hash(ShaderCache::hash(SHADER_CACHE_SEED, vertexCode.c_str()),
+            fragmentCode.c_str()), geometryCode.c_str());
+        if (shaderCache.load(ID, key))
+            return;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
+        // 3. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -59,83 +59,225 @@ public:
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry = 0;
+        if (geometryPath != NULL)
+        {
+            const char* gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if (geometryPath != NULL)
+            glAttachShader(ID, geometry);
+        shaderCache.prepare(ID);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        if (geometryPath != NULL)
+            glDeleteShader(geometry);
+        shaderCache.store(ID, key, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     }
-    // activate the shader
+    // vertex-only program whose outputs are captured with transform feedback,
+    // the varyings are interleaved into one buffer in the given order
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* const* feedbackVaryings, int feedbackCount)
+    {
+        std::string vertexCode;
+        readSource(vertexPath, NULL, vertexCode);
+        // the varyings are linked into the binary as well
+        ID = glCreateProgram();
+        uint64_t key = ShaderCache::hash(SHADER_CACHE_SEED, vertexCode.c_str());
+        for (int i = 0; i < feedbackCount; ++i)
+            key = ShaderCache::hash(key, feedbackVaryings[i]);
+        if (shaderCache.load(ID, key))
+            return;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const char* vShaderCode = vertexCode.c_str();
+        unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        glAttachShader(ID, vertex);
+        // must be set before linking
+        glTransformFeedbackVaryings(ID, feedbackCount, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
+        shaderCache.prepare(ID);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(vertex);
+        shaderCache.store(ID, key, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    // activate the shader, nothing reaches GL when it is already in use
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        glState.useProgram(ID);
     }
-    // utility uniform functions
+    // utility uniform functions, names are C strings: a std::string made from a long literal
+    // would go to the heap on every call
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(const char* name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(glGetUniformLocation(ID, name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(glGetUniformLocation(ID, name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(glGetUniformLocation(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(const char* name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // files of the sources, in the numbering of their #line directives
+    std::vector<std::string> sourceFiles;
+
+    // source of one stage: each #include "file" line is replaced by the file, a file is included
+    // once per stage, paths are relative to the working directory like the shaders themselves;
+    // #line directives keep the compiler's messages on the file and line they come from
+    // ------------------------------------------------------------------------
+    void readSource(const char* path, const char* defines, std::string& code)
+    {
+        std::vector<std::string> included(1, path);
+        if (!appendSource(path, defines, code, included, 0))
+            code.clear();
+    }
+
+    bool appendSource(const std::string& path, const char* defines, std::string& code, std::vector<std::string>& included,
+        int depth)
+    {
+        std::ifstream file(path.c_str());
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+        std::size_t index = 0;
+        while (index < sourceFiles.size() && sourceFiles[index] != path)
+            ++index;
+        if (index == sourceFiles.size())
+            sourceFiles.push_back(path);
+        if (depth > 0)
+            appendLine(code, 1, index);
+
+        std::string line;
+        int number = 0;
+        while (std::getline(file, line))
+        {
+            ++number;
+            std::size_t start = line.find_first_not_of(" \t");
+            if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+            {
+                std::size_t open = line.find('"', start + 8), close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos || depth + 1 >= SHADER_MAX_INCLUDE_DEPTH)
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_RESOLVED: " << path << ":" << number << " " << line << std::endl;
+                    return false;
+                }
+                std::string name = line.substr(open + 1, close - open - 1);
+                bool seen = false;
+                for (std::size_t i = 0; i < included.size() && !seen; ++i)
+                    seen = included[i] == name;
+                if (!seen)
+                {
+                    included.push_back(name);
+                    if (!appendSource(name, defines, code, included, depth + 1))
+                        return false;
+                }
+                appendLine(code, number + 1, index);
+                continue;
+            }
+            code += line;
+            code += '\n';
+            // the defines go right after the version, the only thing allowed before them
+            if (depth == 0 && start != std::string::npos && line.compare(start, 8, "#version") == 0)
+            {
+                appendDefines(code, defines);
+                appendLine(code, number + 1, index);
+            }
+        }
+        return true;
+    }
+
+    static void appendLine(std::string& code, int number, std::size_t file)
+    {
+        char directive[48];
+        std::snprintf(directive, sizeof(directive), "#line %d %u\n", number, (unsigned int)file);
+        code += directive;
+    }
+
+    static void appendDefines(std::string& code, const char* defines)
+    {
+        const char* name = defines;
+        while (name && *name)
+        {
+            while (*name == ' ')
+                ++name;
+            std::size_t length = std::strcspn(name, " ");
+            if (length == 0)
+                break;
+            std::string define(name, length);
+            std::size_t equals = define.find('=');
+            if (equals == std::string::npos)
+                define += " 1";
+            else
+                define[equals] = ' ';
+            code += "#define " + define + "\n";
+            name += length;
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -148,7 +290,7 @@ private:
             if (!success)
             {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << sourceList() << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
         else
@@ -161,5 +303,13 @@ private:
             }
         }
     }
+    // source file numbers of the compiler's messages, with includes there is more than one
+    std::string sourceList() const
+    {
+        std::string list;
+        for (std::size_t i = 0; sourceFiles.size() > 1 && i < sourceFiles.size(); ++i)
+            list += (i == 0 ? "sources: " : ", ") + std::to_string(i) + " " + sourceFiles[i];
+        return list;
+    }
 };
 #endif#pragma once
@@ -6,27 +6,105 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <header/Annulus.h>
+#include <header/AsteroidBelt.h>
+#include <header/Benchmark.h>
+#include <header/BodyTransform.h>
 #include <header/camera.h>
+#include <header/Checkpoint.h>
+#include <header/Ephemeris.h>
+#include <header/Frustum.h>
+#include <header/GLState.h>
+#include <header/GLTrace.h>
+#include <header/HeapTracker.h>
+#include <header/Occlusion.h>
+#include <header/OrbitPaths.h>
+#include <header/Overlay.h>
+#include <header/Profiler.h>
+#include <header/Recorder.h>
+#include <header/RenderBackend.h>
 #include <header/shader_m.h>
+#include <header/ShaderCache.h>
+#include <header/ShaderVariants.h>
+#include <header/Simulation.h>
 #include <header/Sphere.h>
+#include <header/Starfield.h>
+#include <header/TransformGraph.h>
 #include <header/stb_image.h>
 
 #include <iostream>
 #include <vector>
 
+// Features of the body shaders body.vs and body.fs, the bits of their ShaderVariants
+enum BodyShaderFeature
+{
+    BODY_LIT = 0,               // a planet lit by the sun, none of the features
+    BODY_EMISSIVE = 1 << 0,     // unlit, the sun
+    BODY_RINGED = 1 << 1,       // with the shadow of its rings
+    BODY_IMPOSTOR = 1 << 2      // ray-cast on a quad, distant bodies
+};
+const char* const BODY_SHADER_FEATURES[] = { "EMISSIVE", "RINGED", "IMPOSTOR" };
+const unsigned int BODY_SHADER_FEATURE_COUNT = sizeof(BODY_SHADER_FEATURES) / sizeof(BODY_SHADER_FEATURES[0]);
+
+// Body drawn by the render loops, placed in the transform hierarchy by addBodies
+struct CelestialBody
+{
+    Sphere* sphere;
+    Shader* shader;         // variant of the body shaders for the mesh
+    int parent;             // index of the parent body, -1 for the sun
+    int ephemerisBody;      // Ephemeris_Body, -1 when the body is not in the ephemeris
+    float distance;         // orbit radius, multiplied by distanceScale
+    float distanceScale;
+    float orbitalPeriod;    // years, 0 when the body does not orbit its parent
+    float rotationPeriod;   // years, negative for retrograde rotation
+    float rotationAxis;     // axial tilt
+    Annulus* ring = NULL;   // rings in the equatorial plane, NULL when the body has none
+    int orbitNode = -1;     // orbit frame in the transform hierarchy, inherited by moons, set by addBodies
+    int transform = -1;     // index in the body transform batch, holds the model matrix, set by addBodies
+};
+
+// What the last frame drew
+struct RenderStats
+{
+    unsigned int visible;   // bodies inside the view frustum
+    unsigned int culled;    // bodies skipped by frustum culling
+    unsigned int occluded;  // bodies whose last finished occlusion query found no samples
+    unsigned int queries;   // occlusion queries issued
+};
+
 // Function declarations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
+void saveCheckpoint(const char* path);
+void loadCheckpoint(const char* path);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void drawSphere(Sphere sphere, Shader shaderProgram, bool wireframe);
+void drawSphere(Sphere& sphere, const Shader& shaderProgram, bool wireframe);
+void deleteSphere(Sphere& sphere);
+void drawImpostor(const Sphere& sphere, const Shader& shaderProgram, const glm::mat4& model);
+void deleteImpostor();
+float screenRadius(float radius, const glm::vec3& center);
+void drawBodies(const CelestialBody* bodies, int count, const BodyTransformBatch& batch, const Shader& impostorShader,
+    const Shader& emissiveImpostorShader, const glm::mat4& projection, const glm::mat4& view);
+float boundingRadius(const CelestialBody& body);
+void drawRing(Annulus& ring, const Shader& shaderProgram, const glm::mat4& model, float planetRadius);
+void drawRings(const CelestialBody* bodies, const BodyTransformBatch& batch, const Shader& ringShader);
+void deleteRing(Annulus& ring);
+void showRenderStats(GLFWwindow* window);
+void setCameraUniforms(const Shader& shaderProgram, const glm::mat4& projection, const glm::mat4& view);
+void setPlanetLighting(const Shader& shaderProgram);
+void addBodies(TransformGraph& transforms, BodyTransformBatch& batch, CelestialBody* bodies, int count);
+void updateBodies(TransformGraph& transforms, BodyTransformBatch& batch, CelestialBody* bodies, int count, const Ephemeris& ephemeris, double day, float time);
+void updateOrbitPaths(OrbitPaths& orbits, const CelestialBody* bodies, int count, const BodyTransformBatch& batch, const Ephemeris& ephemeris, double day, float time);
 unsigned int loadTexture(const char* path);
-int solarScaledSize(bool isBackgroundBlack);
-int solarScaledDistance(bool isBackgroundBlack);
+int solarScaledSize(bool isBackgroundBlack, const BackendOptions& backendOptions);
+int solarScaledDistance(bool isBackgroundBlack, const BackendOptions& backendOptions);
 
 // Constants
 extern const unsigned int SCR_WIDTH;
 extern const unsigned int SCR_HEIGHT;
+extern unsigned int viewportWidth;
+extern unsigned int viewportHeight;
 
 // Camera variables
 extern Camera camera;
@@ -38,8 +116,27 @@ extern bool firstMouse;
 extern float deltaTime;
 extern float lastFrame;
 
+// Simulation time
+extern SimulationClock simulationClock;
+extern CheckpointWriter checkpointWriter;
+
 // OpenGL buffers
-extern unsigned int VBO, VAO, EBO;
+extern unsigned int impostorVAO, impostorVBO;
+extern const float IMPOSTOR_MAX_PIXELS;
+
+// Orbit paths
+extern const double ORBIT_EPOCH_DAYS;
+extern const float ORBIT_LINE_WIDTH;
+extern const glm::vec4 ORBIT_COLOR;
+
+// Culling
+extern FrustumCuller bodyCuller;
+extern OcclusionCuller bodyOcclusion;
+extern std::vector<int> visibleBodies;
+extern std::vector<glm::vec3> bodyCenters;
+extern std::vector<float> bodyDistances;
+extern RenderStats renderStats;
+extern PerformanceOverlay performanceOverlay;
 
 // Planet properties
 extern const float SUN_ROTATION_AXIS;
@@ -62,6 +159,11 @@ extern const float SATURN_RADIUS;
 extern const float URANUS_RADIUS;
 extern const float NEPTUNE_RADIUS;
 
+extern const float SATURN_RING_INNER_RADIUS;
+extern const float SATURN_RING_OUTER_RADIUS;
+extern const float URANUS_RING_INNER_RADIUS;
+extern const float URANUS_RING_OUTER_RADIUS;
+
 extern const float MERCURY_DISTANCE_FROM_SUN;
 extern const float VENUS_DISTANCE_FROM_SUN;
 extern const float EARTH_DISTANCE_FROM_SUN;
@@ -0,0 +1,18 @@
+#version 330 core
+#include "logdepth.glsl"
+
+out vec4 FragColor;
+
+in vec4 Color;
+in float Edge;
+in float ViewDepth;
+
+uniform float lineWidth;
+
+void main()
+{
+    // coverage of the pixel by a line lineWidth wide
+    float coverage = clamp(lineWidth * 0.5 + 0.5 - abs(Edge), 0.0, 1.0);
+    FragColor = vec4(Color.rgb, Color.a * coverage);
+    gl_FragDepth = LogDepthFragment(ViewDepth);
+}
@@ -0,0 +1,66 @@
+#version 330 core
+// every line segment becomes a quad lineWidth pixels wide, plus a pixel for the antialiased edge
+#include "logdepth.glsl"
+
+layout (lines) in;
+layout (triangle_strip, max_vertices = 4) out;
+
+in vec4 LineColor[];
+
+out vec4 Color;
+out float Edge;             // pixels from the center of the line
+out float ViewDepth;
+
+uniform vec2 viewport;      // pixels
+uniform float lineWidth;    // pixels
+
+void emit(vec4 position, vec2 offset, float edge, vec4 color)
+{
+    // offset in pixels, scaled by w so it stays the same size after the perspective divide
+    gl_Position = position + vec4(offset / viewport * 2.0 * position.w, 0.0, 0.0);
+    ViewDepth = position.w;
+    gl_Position = LogDepthClip(gl_Position);
+    Edge = edge;
+    Color = color;
+    EmitVertex();
+}
+
+void main()
+{
+    vec4 a = gl_in[0].gl_Position;
+    vec4 b = gl_in[1].gl_Position;
+    vec4 colorA = LineColor[0];
+    vec4 colorB = LineColor[1];
+    if (colorA.a <= 0.0 && colorB.a <= 0.0)
+        return;
+
+    // clip against the near plane, behind the camera the divide would flip the segment
+    float near = logDepth.x;
+    if (a.w < near && b.w < near)
+        return;
+    if (a.w < near)
+    {
+        float t = (near - a.w) / (b.w - a.w);
+        a = mix(a, b, t);
+        colorA = mix(colorA, colorB, t);
+    }
+    else if (b.w < near)
+    {
+        float t = (near - b.w) / (a.w - b.w);
+        b = mix(b, a, t);
+        colorB = mix(colorB, colorA, t);
+    }
+
+    vec2 screenA = a.xy / a.w * viewport * 0.5;
+    vec2 screenB = b.xy / b.w * viewport * 0.5;
+    vec2 direction = screenB - screenA;
+    direction = dot(direction, direction) > 1e-12 ? normalize(direction) : vec2(1.0, 0.0);
+    float halfWidth = lineWidth * 0.5 + 1.0;
+    vec2 normal = vec2(-direction.y, direction.x) * halfWidth;
+
+    emit(a, normal, halfWidth, colorA);
+    emit(a, -normal, -halfWidth, colorA);
+    emit(b, normal, halfWidth, colorB);
+    emit(b, -normal, -halfWidth, colorB);
+    EndPrimitive();
+}
@@ -0,0 +1,15 @@
+// logarithmic depth of every shader that draws, the range is set by LogDepthParameters in camera.h
+uniform vec2 logDepth;      // near plane, 1 / log2(far / near)
+
+// clip position with the depth the fragment shaders write, so clipping matches it
+vec4 LogDepthClip(vec4 clip)
+{
+    clip.z = (2.0 * log2(max(clip.w, 1e-30) / logDepth.x) * logDepth.y - 1.0) * clip.w;
+    return clip;
+}
+
+// per pixel, the depth interpolated from the vertices is only exact at the vertices
+float LogDepthFragment(float viewDepth)
+{
+    return log2(viewDepth / logDepth.x) * logDepth.y;
+}
@@ -0,0 +1,11 @@
+#version 330 core
+// occlusion proxy, only the depth test of its fragments matters
+#include "logdepth.glsl"
+
+in float ViewDepth;
+
+void main()
+{
+    // exact per pixel, vertex-interpolated logarithmic depth would sit behind the quad
+    gl_FragDepth = LogDepthFragment(ViewDepth);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec4 aPlacement;   // per orbit: parent position relative to the camera, phase of the body
+layout (location = 1) in vec4 aColor;       // per orbit: color and opacity
+
+out vec4 LineColor;
+
+uniform samplerBuffer points;   // per orbit pointCount points: xyz relative to the parent, w fraction of the period
+uniform int pointCount;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 point = texelFetch(points, gl_InstanceID * pointCount + gl_VertexID);
+
+    // trail: opaque right behind the body, fading over one period to the point just ahead of it
+    float behind = fract(aPlacement.w - point.w);
+    LineColor = vec4(aColor.rgb, aColor.a * mix(1.0, 0.1, behind));
+
+    gl_Position = projection * view * vec4(aPlacement.xyz + point.xyz, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;         // pixels from the top left corner
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform vec2 viewport;
+
+void main()
+{
+    TexCoord = aTexCoord;
+    Color = aColor;
+    gl_Position = vec4(aPos.x / viewport.x * 2.0 - 1.0, 1.0 - aPos.y / viewport.y * 2.0, 0.0, 1.0);
+}
@@ -0,0 +1,45 @@
+#version 330 core
+#include "logdepth.glsl"
+#include "lighting.glsl"
+
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 LocalPos;
+in float ViewDepth;
+
+uniform sampler2D ringTexture;  // radial strip, inner edge at s = 0
+uniform vec2 ringRadii;         // inner and outer radius, model units
+uniform vec3 planetCenter;      // relative to the camera, like FragPos
+uniform float planetRadius;
+uniform PointLight pointLights;
+
+void main()
+{
+    // exact round edges, the mesh is a polygon around them
+    float r = length(LocalPos);
+    float s = (r - ringRadii.x) / (ringRadii.y - ringRadii.x);
+    if (s < 0.0 || s > 1.0)
+        discard;
+
+    // the ring textures have no alpha, gaps are dark
+    vec3 albedo = texture(ringTexture, vec2(s, 0.5)).rgb;
+    float alpha = smoothstep(0.05, 0.5, dot(albedo, vec3(0.299, 0.587, 0.114)));
+
+    // planet shadow: does the ray to the sun pass through the planet, with a narrow penumbra
+    vec3 toLight = pointLights.position - FragPos;
+    vec3 lightDir = normalize(toLight);
+    vec3 toPlanet = planetCenter - FragPos;
+    float along = dot(toPlanet, lightDir);
+    float miss = sqrt(max(dot(toPlanet, toPlanet) - along * along, 0.0));
+    float lit = along > 0.0 ? smoothstep(0.97, 1.03, miss / planetRadius) : 1.0;
+
+    // a layer of particles, lit from either side and scattering even when the sun is near its plane
+    float diff = 0.6 + 0.4 * abs(dot(normalize(Normal), lightDir));
+    float attenuation = CalcAttenuation(pointLights, length(toLight));
+    vec3 color = (pointLights.ambient + pointLights.diffuse * diff * lit) * albedo * attenuation;
+
+    FragColor = vec4(color, alpha);
+    gl_FragDepth = LogDepthFragment(ViewDepth);
+}
@@ -0,0 +1,26 @@
+#version 330 core
+#include "logdepth.glsl"
+
+layout (location = 0) in vec3 aPos;         // annulus in the planet's equatorial plane
+layout (location = 1) in vec3 aNormal;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 LocalPos;
+out float ViewDepth;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+
+    ViewDepth = gl_Position.w;
+    gl_Position = LogDepthClip(gl_Position);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(model) * aNormal;
+    LocalPos = aPos.xy;
+}
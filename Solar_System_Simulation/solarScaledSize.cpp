@@ -1,50 +1,33 @@
 #include <header/solar.h>
 
-int solarScaledSize(bool isBackgroundBlack)
+int solarScaledSize(bool isBackgroundBlack, const BackendOptions& backendOptions)
 {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Solar_System", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    // window, or framebuffer object without a display
+    // -------------------------------------------------
+    RenderBackend backend;
+    if (!backend.create(backendOptions, SCR_WIDTH, SCR_HEIGHT, "Solar_System"))
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+#ifndef SOLAR_NO_WINDOW
+    GLFWwindow* window = backend.getWindow();
+#endif
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    glState.enable(GL_DEPTH_TEST);
 
-    // build and compile our shader program
+    // build and compile our shader programs, the variants of the body shaders on the loader
+    // thread while the textures load
     // ------------------------------------
-    Shader planetShader("solar.vs", "solar.fs"), sunShader("solar.vs", "sun.fs");
+    ShaderVariants bodyShaders;
+    bodyShaders.create("body.vs", "body.fs", BODY_SHADER_FEATURES, BODY_SHADER_FEATURE_COUNT, &backend);
+    bodyShaders.request(BODY_LIT);
+    bodyShaders.request(BODY_RINGED);
+    bodyShaders.request(BODY_EMISSIVE);
+    bodyShaders.request(BODY_IMPOSTOR);
+    bodyShaders.request(BODY_IMPOSTOR | BODY_EMISSIVE);
+    Shader ringShader("ring.vs", "ring.fs");
 
     // load and create a texture 
     // -------------------------
@@ -56,13 +39,13 @@ int solarScaledSize(bool isBackgroundBlack)
         marsTexture = loadTexture("mars.jpg"),
         jupiterTexture = loadTexture("jupiter.jpg"),
         saturnTexture = loadTexture("saturn.jpg"),
-        saturnRingTexture = loadTexture("saturnRing.jpg"),
+        saturnRingTexture = loadTexture("saturnring.jpg"),
         uranusTexture = loadTexture("uranus.jpg"),
-        uranusRingTexture = loadTexture("uranusRing.jpg"),
+        uranusRingTexture = loadTexture("uranusring.jpg"),
         neptuneTexture = loadTexture("neptune.jpg");
 
     // unbind texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glState.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, 0);
 
     // create stars
 
@@ -111,40 +94,108 @@ int solarScaledSize(bool isBackgroundBlack)
     uranus.setTextureInt(8);
     uranus.setTextureGL(GL_TEXTURE8);
 
+    // rings, in the texture units left free next to their planets
+    Annulus saturnRing(SATURN_RING_INNER_RADIUS * mult, SATURN_RING_OUTER_RADIUS * mult),
+        uranusRing(URANUS_RING_INNER_RADIUS * mult, URANUS_RING_OUTER_RADIUS * mult);
+
+    saturnRing.setTexture(saturnRingTexture);
+    saturnRing.setTextureInt(7);
+    saturnRing.setTextureGL(GL_TEXTURE7);
+
+    uranusRing.setTexture(uranusRingTexture);
+    uranusRing.setTextureInt(9);
+    uranusRing.setTextureGL(GL_TEXTURE9);
+
     neptune.setTexture(neptuneTexture);
     neptune.setTextureInt(10);
     neptune.setTextureGL(GL_TEXTURE10);
 
-    // set uniform of planetShader
+    // the body shaders, planets with rings have their shadow, the sun is unlit
+    Shader& planetShader = bodyShaders.get(BODY_LIT);
+    Shader& ringedShader = bodyShaders.get(BODY_RINGED);
+    Shader& sunShader = bodyShaders.get(BODY_EMISSIVE);
+    Shader& impostorShader = bodyShaders.get(BODY_IMPOSTOR);
+    Shader& emissiveImpostorShader = bodyShaders.get(BODY_IMPOSTOR | BODY_EMISSIVE);
+
+    // startup: how the programs so far were built, from cached binaries or from source
+    bodyShaders.printSummary();
+    shaderCache.printSummary();
+
+    // set uniform of the lit shaders
+    setPlanetLighting(planetShader);
+    setPlanetLighting(ringedShader);
+    setPlanetLighting(impostorShader);
+    setPlanetLighting(ringShader);
+
+    // logarithmic depth for every shader that draws
+    sunShader.use();
+    sunShader.setVec2("logDepth", LogDepthParameters());
     planetShader.use();
+    planetShader.setVec2("logDepth", LogDepthParameters());
+    ringedShader.use();
+    ringedShader.setVec2("logDepth", LogDepthParameters());
+    impostorShader.use();
+    impostorShader.setVec2("logDepth", LogDepthParameters());
+    emissiveImpostorShader.use();
+    emissiveImpostorShader.setVec2("logDepth", LogDepthParameters());
+    ringShader.use();
+    ringShader.setVec2("logDepth", LogDepthParameters());
+
+    // bodies in the transform hierarchy, the sun first as parent of every planet
+    // scale distance for visibility
+    float start = 25.0;
+    CelestialBody bodies[] = {
+        { &sun, &sunShader, -1, -1, 0.0f, 1.0f, 0.0f, SUN_ROTATION_PERIOD_YEAR, SUN_ROTATION_AXIS },
+        { &mercury, &planetShader, 0, EPH_MERCURY, start, 1.0f, MERCURY_ORBITAL_PERIOD_YEAR, MERCURY_ROTATION_PERIOD_YEAR, MERCURY_ROTATION_AXIS },
+        { &venus, &planetShader, 0, EPH_VENUS, start + 1 * 5.0f, 1.0f, VENUS_ORBITAL_PERIOD_YEAR, -VENUS_ROTATION_PERIOD_YEAR, VENUS_ROTATION_AXIS },
+        { &earth, &planetShader, 0, EPH_EARTH, start + 2 * 5.0f, 1.0f, EARTH_ORBITAL_PERIOD_YEAR, EARTH_ROTATION_PERIOD_YEAR, EARTH_ROTATION_AXIS },
+        { &mars, &planetShader, 0, EPH_MARS, start + 3 * 5.0f, 1.0f, MARS_ORBITAL_PERIOD_YEAR, MARS_ROTATION_PERIOD_YEAR, MARS_ROTATION_AXIS },
+        { &jupiter, &planetShader, 0, EPH_JUPITER, start + 4 * 5.0f, 1.0f, JUPITER_ORBITAL_PERIOD_YEAR, JUPITER_ROTATION_PERIOD_YEAR, JUPITER_ROTATION_AXIS },
+        { &saturn, &ringedShader, 0, EPH_SATURN, start + 5 * 5.0f, 1.0f, SATURN_ORBITAL_PERIOD_YEAR, SATURN_ROTATION_PERIOD_YEAR, SATURN_ROTATION_AXIS, &saturnRing },
+        { &uranus, &ringedShader, 0, EPH_URANUS, start + 6 * 5.0f, 1.0f, URANUS_ORBITAL_PERIOD_YEAR, -URANUS_ROTATION_PERIOD_YEAR, URANUS_ROTATION_AXIS, &uranusRing },
+        { &neptune, &planetShader, 0, EPH_NEPTUNE, start + 7 * 5.0f, 1.0f, NEPTUNE_ORBITAL_PERIOD_YEAR, NEPTUNE_ROTATION_PERIOD_YEAR, NEPTUNE_ROTATION_AXIS }
+    };
+    const int bodyCount = sizeof(bodies) / sizeof(bodies[0]);
+
+    TransformGraph transforms;
+    BodyTransformBatch bodyTransforms;
+    addBodies(transforms, bodyTransforms, bodies, bodyCount);
+
+    // orbit path of every body, drawn in one call
+    OrbitPaths orbitPaths;
+    orbitPaths.create(bodyCount);
+
+    // scaled size version keeps circular orbits
+    Ephemeris ephemeris;
+
+    // background stars (build with --build-stars), streamed in while the window is already up
+    Starfield starfield;
+    if (!starfield.open(STAR_CATALOG_FILE))
+    {
+        std::cout << "Star catalog " << STAR_CATALOG_FILE << " not loaded" << std::endl;
+    }
 
-    // shininess for specular light
-    planetShader.setFloat("material.shininess", 32.0f);
-
-    // pointlight properties
-    planetShader.setVec3("pointLights.position", 0.0f, 0.0f, 0.0f);
-    planetShader.setVec3("pointLights.ambient", 0.2f, 0.2f, 0.2f);
-    planetShader.setVec3("pointLights.diffuse", 0.5f, 0.5f, 0.5f);
-    planetShader.setVec3("pointLights.specular", 1.0f, 1.0f, 1.0f);
-    planetShader.setFloat("pointLights.constant", 1.0f);
-    planetShader.setFloat("pointLights.linear", 0.09f);
-    planetShader.setFloat("pointLights.quadratic", 0.032f);
-    planetShader.setFloat("pointLights.linear", 0.0014f);
-    planetShader.setFloat("pointLights.quadratic", 0.000007f);
+    // frame time graph and renderer counters on top of everything
+    performanceOverlay.setVisible(backendOptions.overlay);
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    while (backend.beginFrame())
     {
         // per-frame time logic
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
+        float currentFrame = static_cast<float>(backend.getTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        simulationClock.advance(deltaTime);
+        glState.beginFrame();
 
-        // input
+        // input, none offscreen
         // -----
-        processInput(window);
+#ifndef SOLAR_NO_WINDOW
+        if (window)
+            processInput(window);
+#endif
 
         // render
         // ------ 
@@ -158,122 +209,66 @@ int solarScaledSize(bool isBackgroundBlack)
         }
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        planetShader.use();
-
-        // camera position
-        planetShader.setVec3("viewPos", camera.Position);
-
         // projection matrix
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 projection = camera.GetProjectionMatrix((float)viewportWidth / (float)viewportHeight);
 
         // camera/view transformation
         glm::mat4 view = camera.GetViewMatrix();
 
+        // stars first, behind everything and without depth
+        starfield.update();
+        starfield.draw(projection, view);
+
+        // update every body's transform in one pass
+        updateBodies(transforms, bodyTransforms, bodies, bodyCount, ephemeris, 0.0, (float)simulationClock.getTime());
+
+        // camera-relative: the view only rotates and the bodies and the sun light are placed relative to the camera
+        setCameraUniforms(sunShader, projection, view);
+        setCameraUniforms(planetShader, projection, view);
+        setCameraUniforms(ringedShader, projection, view);
+        setCameraUniforms(impostorShader, projection, view);
+        setCameraUniforms(emissiveImpostorShader, projection, view);
+        setCameraUniforms(ringShader, projection, view);
+
         // model transformation (different for each object), then draw
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)(360 - SUN_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / SUN_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        sunShader.use();
-        sunShader.setMat4("projection", projection);
-        sunShader.setMat4("view", view);
-        sunShader.setMat4("model", model);
-        drawSphere(sun, sunShader, false);
-
-        planetShader.use();
-        planetShader.setMat4("projection", projection);
-        planetShader.setMat4("view", view);
-
-        // scale distance for visibility
-        float start = 25.0;
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / MERCURY_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - MERCURY_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / MERCURY_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(mercury, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / VENUS_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 1 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - VENUS_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, -(float)glfwGetTime() / VENUS_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(venus, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / EARTH_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 2 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - EARTH_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / EARTH_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(earth, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / MARS_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 3 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - MARS_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / MARS_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(mars, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / JUPITER_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 4 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - JUPITER_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / JUPITER_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(jupiter, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / SATURN_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 5 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - SATURN_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / SATURN_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(saturn, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / URANUS_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 6 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - URANUS_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, -(float)glfwGetTime() / URANUS_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(uranus, planetShader, false);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() / NEPTUNE_ORBITAL_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(start + 7 * 5.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(360 - NEPTUNE_ROTATION_AXIS), glm::vec3(1.0f, 0.0f, 1.0f));
-        model = glm::rotate(model, (float)90.0, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime() / NEPTUNE_ROTATION_PERIOD_YEAR, glm::vec3(0.0f, 1.0f, 0.0f));
-        planetShader.setMat4("model", model);
-        drawSphere(neptune, planetShader, false);
-
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        drawBodies(bodies, bodyCount, bodyTransforms, impostorShader, emissiveImpostorShader, projection, view);
+
+        // orbits and rings are transparent, after everything opaque
+        updateOrbitPaths(orbitPaths, bodies, bodyCount, bodyTransforms, ephemeris, 0.0, (float)simulationClock.getTime());
+        orbitPaths.draw(projection, view, glm::vec2(viewportWidth, viewportHeight), ORBIT_LINE_WIDTH);
+        drawRings(bodies, bodyTransforms, ringShader);
+        performanceOverlay.draw(viewportWidth, viewportHeight);
+
+#ifndef SOLAR_NO_WINDOW
+        if (window)
+            showRenderStats(window);
+#endif
+
+        // swap buffers and poll IO events, or finish and time the offscreen frame
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        backend.endFrame();
     }
+    backend.printFrameTimes();
+    profiler.printSummary();
+    glTrace.printSummary();
+    heapTracker.printSummary();
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-
-    // glfw: terminate, clearing all previously allocated GLFW resources.
+    checkpointWriter.flush();
+    for (int i = 0; i < bodyCount; ++i)
+        deleteSphere(*bodies[i].sphere);
+    deleteImpostor();
+    deleteRing(saturnRing);
+    deleteRing(uranusRing);
+    orbitPaths.destroy();
+    starfield.destroy();
+    performanceOverlay.destroy();
+    bodyOcclusion.destroy();
+    bodyShaders.destroy();
+
+    // glfw: terminate, clearing all previously allocated GLFW resources, or release the offscreen context
     // ------------------------------------------------------------------
-    glfwTerminate();
+    backend.destroy();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 StarColor;
+
+void main()
+{
+    // gaussian spot over the sprite, zero at its edge
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot(offset, offset);
+    if (r2 > 1.0)
+        discard;
+    FragColor = vec4(StarColor, exp(-4.0 * r2) - exp(-4.0));
+}
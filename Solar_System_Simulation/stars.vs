@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aDirection;
+layout (location = 1) in vec4 aStar;        // rgb color, a magnitude as (V + 2) / 16
+
+out vec3 StarColor;
+
+uniform float referenceMagnitude;
+uniform mat4 view;          // rotation only
+uniform mat4 projection;
+
+void main()
+{
+    // flux relative to a star of the reference magnitude, the sprite grows with its square root
+    // and fainter stars than fill the smallest sprite get dimmer instead
+    float magnitude = aStar.a * 255.0 / 16.0 - 2.0;
+    float flux = pow(10.0, -0.4 * (magnitude - referenceMagnitude));
+    float size = clamp(2.0 * sqrt(flux), 1.5, 8.0);
+    StarColor = aStar.rgb * min(1.0, 4.0 * flux / (size * size));
+
+    // at infinity: on the far plane, whatever the depth range
+    gl_Position = projection * view * vec4(aDirection, 1.0);
+    gl_Position.z = gl_Position.w;
+    gl_PointSize = size;
+}